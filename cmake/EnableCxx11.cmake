@@ -39,9 +39,9 @@ elseif(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
     # GCC >= 4.5.3
     # GCC is pretty schizophrenic when it comes to the name of the new C++
     # standard...
-    if(CMAKE_CXX_COMPILER_VERSION STRGREATER "4.7./")
+    if(NOT CMAKE_CXX_COMPILER_VERSION VERSION_LESS "4.7")
         set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++11")
-    else(CMAKE_CXX_COMPILER_VERSION STRGREATER "4.5.2")
+    else()
             set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++0x")
     endif()
 endif()
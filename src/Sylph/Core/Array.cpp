@@ -25,8 +25,17 @@
 #include "Array.h"
 #include "String.h"
 
+#include <cstdio>
+
 SYLPH_BEGIN_NAMESPACE
 
+void throwArrayOverflow(sidx_t idx, size_t length, const char * what) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%s overflow - index: %lld , length: %llu",
+            what, (long long) idx, (unsigned long long) length);
+    sthrow(ArrayException, buf);
+}
+
 SYLPH_SPECIALIZE_PRIMS(Array);
 
 SYLPH_END_NAMESPACE
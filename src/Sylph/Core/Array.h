@@ -33,22 +33,48 @@
 #include "Exception.h"
 #include "Range.h"
 #include "Primitives.h"
+#include "RefCount.h"
 
 #include <algorithm>
 #include <iostream>
 
 #include <initializer_list>
 
+/*
+ * Whether Array::operator[] checks its index. It does unless the library and
+ * the code using it are built with SYLPH_UNCHECKED_ARRAYS
+ * (<code>-DSYLPH_UNCHECKED_ARRAYS=1</code> to cmake), which SYLPH_DEBUG
+ * overrides.
+ */
+#if defined(SYLPH_UNCHECKED_ARRAYS) && !defined(SYLPH_DEBUG)
+#define SYLPH_CHECKED_ARRAYS 0
+#else
+#define SYLPH_CHECKED_ARRAYS 1
+#endif
+
 SYLPH_BEGIN_NAMESPACE
 class Any;
 template<class T> class Array;
 
+/**
+ * Throws the ArrayException for an index outside of an Array. It is kept out
+ * of line, so that the checks in Array::operator[] stay small enough to be
+ * inlined. Other indexed containers pass their own name as @em what.
+ */
+[[noreturn]] void throwArrayOverflow(sidx_t idx, size_t length,
+        const char * what = "Array");
+
 
 /**
  * Array provides a safe array. It works the same like a c-style array (not like
  * std::vector which can expand), but instead of overflowing, it throws an
  * @c Exception whenever you try to access data outside its bounds. Therefore it
  * also keeps track of its own length. <p>
+ * The check costs one comparison per access. Loops that already know their
+ * indices are in range can skip it with unsafeAt(), or walk the elements
+ * from carray() to carrayEnd(). Builds that trust all their indices can turn
+ * the checks off altogether with @c SYLPH_UNCHECKED_ARRAYS, except in debug
+ * builds. <p>
  * The Array class provided here is reference-counted, which means it's
  * perfectly safe and even recommended to pass it by value instead of by
  * reference or by pointer. This way, the Array acts more like a builtin type
@@ -90,11 +116,11 @@ public:
         }
 
         typename super::value_type& current() {
-            return (*_obj)[_currentIndex];
+            return _obj->carray()[_currentIndex];
         }
 
         typename super::const_reference current() const {
-            return (*_obj)[_currentIndex];
+            return _obj->carray()[_currentIndex];
         }
 
         bool hasNext() const {
@@ -152,7 +178,8 @@ public:
      */
     inline static Array<T> fromPointer(size_t length, T * orig) {
         Array<T> ar(length);
-        for (idx_t x = 0; x < length; x++)ar[x] = orig[x];
+        T * dest = ar.carray();
+        for (idx_t x = 0; x < length; x++) dest[x] = orig[x];
         return ar;
     }
 public:
@@ -214,7 +241,21 @@ public:
      */
     Array(const Array<T> & other) : _length(other._length), length(_length),
         data(other.data){
-        data->refcount++;
+        if (data) data->refcount.acquire();
+    }
+
+    /**
+     * Creates an Array taking over the reference counted data of another
+     * Array. The reference count does not change, and nothing is allocated.
+     * The other Array is left empty, with a length of 0 and no reference
+     * counted data at all.
+     * @param other An other Array from which to take the reference counted
+     * data.
+     */
+    Array(Array<T> && other) : _length(other._length), length(_length),
+        data(other.data) {
+        other.data = null;
+        other._length = 0;
     }
 
     /**
@@ -259,21 +300,46 @@ public:
      * reaches 0, the internal backing data will be destroyed.
      */
     virtual ~Array() {
-        data->refcount--;
-        if (!data->refcount) {
+        if (data && data->refcount.release()) {
             delete data;
             data = null;
         }
     }
 
+    /**
+     * Returns the element at the given index, without checking it.
+     * @see unsafeAt(idx_t)
+     */
     const T& get(idx_t i) const {
         return data->_carray[i];
     }
 
+    /**
+     * Sets the element at the given index, without checking it.
+     * @see unsafeAt(idx_t)
+     */
     void put(idx_t i, const T& t) {
         data->_carray[i] = t;
     }
 
+    /**
+     * Returns the element at the given index, without checking it. Unlike
+     * operator[], negative indices are not supported, and an index outside
+     * of this Array is undefined behaviour. Use it in loops whose bounds
+     * already keep the index in range.
+     * @param idx The index, which must be smaller than @c length.
+     */
+    T & unsafeAt(idx_t idx) {
+        return data->_carray[idx];
+    }
+
+    /**
+     * The <code>const</code> version of unsafeAt(idx_t).
+     */
+    const T & unsafeAt(idx_t idx) const {
+        return data->_carray[idx];
+    }
+
     /**
      * Creates a copy of this array. The Array returned from this method is
      * an exact copy of this Array, such that ar == ar.copy() . The returned
@@ -284,8 +350,10 @@ public:
      */
     Array<T> copy() const {
         Array<T> toReturn((size_t)length);
-        for (idx_t i = 0; i < length; i++) {
-            toReturn[i] = (*this)[i];
+        const T * src = carray();
+        T * dest = toReturn.carray();
+        for (idx_t i = 0; i < _length; i++) {
+            dest[i] = src[i];
         }
         return toReturn;
     }
@@ -296,7 +364,7 @@ public:
      * returned array are reflected in this Array.
      */
     T * carray() {
-        return data->_carray;
+        return data ? data->_carray : null;
     }
 
     /**
@@ -306,7 +374,23 @@ public:
      * c-style array and is used when this Array is const.
      */
     const T *carray() const {
-        return data->_carray;
+        return data ? data->_carray : null;
+    }
+
+    /**
+     * Returns a pointer just past the last element of carray(). Together,
+     * they allow to walk over the contents without any checks:
+     * <pre>for (T * p = ar.carray(); p != ar.carrayEnd(); ++p)</pre>
+     */
+    T * carrayEnd() {
+        return carray() + _length;
+    }
+
+    /**
+     * The <code>const</code> version of carrayEnd().
+     */
+    const T * carrayEnd() const {
+        return carray() + _length;
     }
 
     /**
@@ -339,7 +423,8 @@ public:
      * default constructor.
      */
     void clear() {
-        delete this->data->_carray;
+        if (!this->data) return;
+        delete[] this->data->_carray;
         this->data->_carray = new T[this->data->_length];
     }
 
@@ -353,31 +438,50 @@ public:
      */
     Array<T> & operator=(const Array<T> & other) {
         if (this->data == other.data) return *this;
-        this->data->refcount--;
-        if (!this->data->refcount) delete this->data;
+        if (other.data) other.data->refcount.acquire();
+        if (this->data && this->data->refcount.release()) delete this->data;
+        this->data = other.data;
+        this->_length = other._length;
+        return *this;
+    }
+
+    /**
+     * Takes over the data pointer of the other Array. No reference count
+     * changes, except for the one of this Array's original data pointer,
+     * which gets decreased by 1. The other Array is left empty.
+     * @param other The other array from which to take the data pointer
+     */
+    Array<T> & operator=(Array<T> && other) {
+        if (this == &other) return *this;
+        if (this->data && this->data->refcount.release()) delete this->data;
         this->data = other.data;
-        this->_length = other.data->_length;
-        data->refcount++;
+        this->_length = other._length;
+        other.data = null;
+        other._length = 0;
         return *this;
     }
 
     /**
      * Used for accessing the Array's contents. Its behavior is identical to
      * that of c-style arrays, but throws an exception instead of overflowing
-     * or causing segfaults. <p>
+     * or causing segfaults. Negative indices count from the end. <p>
      * The Array will assume ownership over any pointers entered in this way.
      * @param idx the index in the array from which to return an element
-     * @throw ArrayException if <code>idx > length</code>
+     * @throw ArrayException if <code>idx >= length</code> or
+     * <code>idx < -length</code>, unless the checks are turned off with
+     * @c SYLPH_UNCHECKED_ARRAYS
      */
-    T & operator[](sidx_t idx) throw (Exception) {
-        if ((idx < (sidx_t)length) && (idx >= -(sidx_t)length)) {
-            return idx >= 0 ? data->_carray[idx] : data->_carray[length + idx];
-        } else {
-            char buf[2048];
-            sprintf(buf, "Array overflow - index: %d , length: %u",
-                    signed(idx), unsigned(length));
-            sthrow(ArrayException, buf);
+    T & operator[](sidx_t idx) {
+#if SYLPH_CHECKED_ARRAYS
+        // a negative index wraps around to a huge one
+        if (size_t(idx) < _length) return data->_carray[idx];
+        if (idx < 0 && size_t(-idx) <= _length) {
+            return data->_carray[_length + idx];
         }
+        throwArrayOverflow(idx, _length);
+#else
+        return data->_carray[idx >= 0 ? idx : _length + idx];
+#endif
     }
 
     /**
@@ -385,17 +489,20 @@ public:
      * is identical to that of c-style const arrays, but throws an exception
      * instead of overflowing or causing segfaults.
      * @param idx the index in the array from which to return an element
-     * @throw ArrayException if <code>idx > length</code>
+     * @throw ArrayException if <code>idx >= length</code> or
+     * <code>idx < -length</code>, unless the checks are turned off with
+     * @c SYLPH_UNCHECKED_ARRAYS
      */
-    const T & operator[](sidx_t idx) const throw (Exception) {
-        if ((idx < (sidx_t)length) && (idx >= -(sidx_t)length)) {
-            return idx >= 0 ? data->_carray[idx] : data->_carray[length + idx];
-        } else {
-            char buf[2048];
-            sprintf(buf, "Array overflow - index: %d , length: %u",
-                    signed(idx), unsigned(length));
-            sthrow(ArrayException, buf);
+    const T & operator[](sidx_t idx) const {
+#if SYLPH_CHECKED_ARRAYS
+        if (size_t(idx) < _length) return data->_carray[idx];
+        if (idx < 0 && size_t(-idx) <= _length) {
+            return data->_carray[_length + idx];
         }
+        throwArrayOverflow(idx, _length);
+#else
+        return data->_carray[idx >= 0 ? idx : _length + idx];
+#endif
     }
 
     /**
@@ -458,12 +565,12 @@ protected:
         }
 
         virtual ~Data() {
-            delete _carray;
+            delete[] _carray;
         }
         const size_t _length;
         T * _carray;
-        uint32_t refcount;
-    } * data;
+        RefCount refcount;
+    } * data; // null once the Array has been moved from
 #endif
 };
 
@@ -478,8 +585,10 @@ protected:
 template<class T>
 inline bool operator==(const Array<T>& lhs, const Array<T>& rhs) {
     if(lhs.length == rhs.length) {
+        const T * l = lhs.carray();
+        const T * r = rhs.carray();
         for(idx_t i = 0; i < lhs.length; i++) {
-            if(lhs[i] != rhs[i]) return false;
+            if(l[i] != r[i]) return false;
         }
         return true;
     }
@@ -0,0 +1,120 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "Collator.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <unicode/ucol.h>
+
+SYLPH_BEGIN_NAMESPACE
+
+CollationKey::CollationKey() {
+}
+
+CollationKey::CollationKey(const String source, const Array<byte> key) :
+        _source(source), _key(key) {
+}
+
+int CollationKey::compareTo(const CollationKey& other) const {
+    size_t len = _key.length < other._key.length ? _key.length :
+            other._key.length;
+    int toReturn = std::memcmp(_key.carray(), other._key.carray(), len);
+    if (toReturn != 0) return toReturn;
+    return (_key.length > other._key.length) -
+            (_key.length < other._key.length);
+}
+
+bool operator==(const CollationKey& lhs, const CollationKey& rhs) {
+    return lhs.compareTo(rhs) == 0;
+}
+
+bool operator<(const CollationKey& lhs, const CollationKey& rhs) {
+    return lhs.compareTo(rhs) < 0;
+}
+
+Collator::Collator(const String locale, Strength strength) {
+    UErrorCode error = U_ZERO_ERROR;
+    _collator = ucol_open(locale.empty() ? null : locale.utf8(), &error);
+    if (U_FAILURE(error)) sthrow(Exception, u_errorName(error));
+    UColAttributeValue value;
+    switch (strength) {
+    case Primary:
+        value = UCOL_PRIMARY;
+        break;
+    case Secondary:
+        value = UCOL_SECONDARY;
+        break;
+    case Identical:
+        value = UCOL_IDENTICAL;
+        break;
+    default:
+        value = UCOL_TERTIARY;
+    }
+    ucol_setStrength(_collator, value);
+}
+
+Collator::~Collator() {
+    ucol_close(_collator);
+}
+
+int Collator::compare(const String lhs, const String rhs) const {
+    return ucol_strcoll(_collator, (const UChar*)lhs.rawdata(), lhs.length(),
+            (const UChar*)rhs.rawdata(), rhs.length());
+}
+
+CollationKey Collator::key(const String s) const {
+    // Most keys fit on the stack, so only the final Array is allocated.
+    uint8_t small[256];
+    uint8_t * buf = small;
+    int32_t len = ucol_getSortKey(_collator, (const UChar*)s.rawdata(),
+            s.length(), buf, sizeof(small));
+    if (len > int32_t(sizeof(small))) {
+        buf = new uint8_t[len];
+        len = ucol_getSortKey(_collator, (const UChar*)s.rawdata(),
+                s.length(), buf, len);
+    }
+    if (len == 0) {
+        if (buf != small) delete[] buf;
+        sthrow(Exception, "Could not compute sort key");
+    }
+    Array<byte> key(size_t(len - 1));
+    carraycopy(buf, 0, key.carray(), 0, len - 1);
+    if (buf != small) delete[] buf;
+    return CollationKey(s, key);
+}
+
+void Collator::sort(Array<String>& strings) const {
+    Array<CollationKey> keys(strings.length);
+    for (idx_t i = 0; i < strings.length; ++i) keys[i] = key(strings[i]);
+    std::sort(keys.carray(), keys.carray() + keys.length);
+    for (idx_t i = 0; i < strings.length; ++i) strings[i] = keys[i].source();
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
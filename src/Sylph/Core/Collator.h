@@ -0,0 +1,166 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_COLLATOR_H_
+#define SYLPH_CORE_COLLATOR_H_
+
+#include "Object.h"
+#include "Array.h"
+#include "Comparable.h"
+#include "Primitives.h"
+#include "String.h"
+
+struct UCollator;
+
+SYLPH_BEGIN_NAMESPACE
+
+class Collator;
+
+/**
+ * A String together with its sort key for a particular Collator. Comparing
+ * two CollationKeys compares their sort keys byte by byte, which gives the
+ * same order as Collator::compare() on the original Strings, but is much
+ * cheaper. When the same Strings are compared over and over, e.g. while
+ * sorting, it pays to create a CollationKey for each of them once and
+ * compare those instead. Keys made by different Collators cannot be
+ * compared meaningfully.
+ */
+class CollationKey : public virtual Object {
+    friend class Collator;
+    friend bool operator==(const CollationKey& lhs, const CollationKey& rhs);
+    friend bool operator<(const CollationKey& lhs, const CollationKey& rhs);
+public:
+    /**
+     * Creates an empty CollationKey, which sorts before every other key.
+     */
+    CollationKey();
+
+    /**
+     * Returns the String this key was created for.
+     * @return The original String.
+     */
+    const String& source() const {
+        return _source;
+    }
+
+    /**
+     * Compares this key to another one.
+     * @param other The key to compare to.
+     * @return A negative number if this key sorts before the other one, 0 if
+     * the Strings are equal for the Collator, a positive number otherwise.
+     */
+    int compareTo(const CollationKey& other) const;
+
+private:
+    CollationKey(const String source, const Array<byte> key);
+
+    String _source;
+    // Without ICU's trailing zero byte.
+    Array<byte> _key;
+};
+
+/**
+ * Compares Strings the way a human reader from a given locale expects them to
+ * be sorted, unlike operator<() on Strings, which compares UTF-16 code units.
+ * E.g. in most locales <code>"\\u00E9clair"</code> sorts between
+ * <code>"eclair"</code> and <code>"fclair"</code>, and the order of
+ * <code>"a"</code> and <code>"B"</code> does not depend on case.<p>
+ * Comparing two Strings with compare() walks both of them with the collation
+ * rules of the locale. To sort many Strings, use sort(), or create a
+ * CollationKey for every String once with key() and sort the keys.<p>
+ * A Collator cannot be copied, and should not be used from more than one
+ * thread at the same time.
+ */
+class Collator : public virtual Object {
+public:
+    /**
+     * The differences that are taken into account when comparing.
+     */
+    enum Strength {
+        /** Only differences in base letters, e.g. "a" and "b". */
+        Primary,
+        /** Also differences in accents, e.g. "a" and "\\u00E1". */
+        Secondary,
+        /** Also differences in case, e.g. "a" and "A". */
+        Tertiary,
+        /** Every difference, even between differently normalized text. */
+        Identical
+    };
+
+    /**
+     * Creates a Collator for the given locale.
+     * @param locale The name of the locale, e.g. <code>"de_DE"</code>. If
+     * empty, the default locale is used. Unknown locales fall back to the
+     * closest known one, or to the root collation order.
+     * @param strength The differences to take into account.
+     */
+    explicit Collator(const String locale = "", Strength strength = Tertiary);
+
+    /**
+     * Destroys the Collator. CollationKeys created by it remain valid.
+     */
+    virtual ~Collator();
+
+    /**
+     * Compares two Strings.
+     * @param lhs The first String.
+     * @param rhs The second String.
+     * @return A negative number if @c lhs sorts before @c rhs, 0 if they are
+     * equal for this Collator, a positive number otherwise.
+     */
+    int compare(const String lhs, const String rhs) const;
+
+    /**
+     * Computes the sort key of a String.
+     * @param s The String to compute the key for.
+     * @return A CollationKey that compares with others from this Collator
+     * like @c s would with compare().
+     */
+    CollationKey key(const String s) const;
+
+    /**
+     * Sorts an Array of Strings in the order of this Collator. The sort key
+     * of every String is computed only once.
+     * @param strings The Strings to sort, in place.
+     */
+    void sort(Array<String>& strings) const;
+
+private:
+    Collator(const Collator&);
+    Collator& operator=(const Collator&);
+
+    UCollator * _collator;
+};
+
+bool operator==(const CollationKey& lhs, const CollationKey& rhs);
+bool operator<(const CollationKey& lhs, const CollationKey& rhs);
+
+S_CMP_SEQ(const CollationKey&)
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_COLLATOR_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
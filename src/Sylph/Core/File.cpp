@@ -419,7 +419,7 @@ File& File::append(const String rhs, bool initial) {
     // is THIS path EMPTY?
     if (empty()) {
         // is OTHER path EMPTY?
-        if (rhs == "") {
+        if (rhs.empty()) {
             // is this INITIAL?
             if (initial) {
                 // set EMPTY
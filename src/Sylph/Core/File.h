@@ -29,6 +29,7 @@
 
 #include "Object.h"
 #include "String.h"
+#include "StringView.h"
 #include "Iterator.h"
 #include "Iterable.h"
 #include "Debug.h"
@@ -98,7 +99,7 @@ public:
 
             --end;
 
-            cur = file->path.substring(start, end);
+            cur = file->path.slice(start, end);
             pos = end;
         }
 
@@ -127,11 +128,11 @@ public:
         }
     //private:
         C* file;
-        String cur;
+        StringView cur;
         idx_t pos;
     };
 
-    S_ITERABLE(File, String)
+    S_ITERABLE(File, StringView)
 public:
 
     /**
@@ -219,7 +220,7 @@ public:
      * @return If this File's path is equal to the emtpy path.
      */
     inline bool empty() const {
-        return path == "";
+        return path.empty();
     }
 
     /**
@@ -251,7 +252,7 @@ public:
 
     /** */
     bool hasFilename() const {
-        return filename() != "";
+        return !filename().empty();
     }
 
     /** */
@@ -0,0 +1,625 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "Format.h"
+#include "NumberFormat.h"
+#include "RefCount.h"
+#include "Vector.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+SYLPH_BEGIN_NAMESPACE
+
+// Limits that keep a single replacement field from growing without bound.
+static const size_t MaxWidth = 1000000;
+static const size_t MaxFloatPrecision = 100;
+static const size_t NoPrecision = size_t(-1);
+// Room for 64 binary digits, a sign and a prefix.
+static const size_t IntegerBufferSize = 72;
+// Room for DBL_MAX in fixed notation, with MaxFloatPrecision decimals.
+static const size_t FloatBufferSize = 512;
+
+static const char lowerDigits[] = "0123456789abcdef";
+static const char upperDigits[] = "0123456789ABCDEF";
+
+class Format::Parser {
+public:
+    struct Spec {
+        size_t index;
+        size_t width;
+        size_t precision;
+        char fill;
+        char align;
+        char sign;
+        char type;
+        bool alternate;
+        bool zero;
+    };
+
+    // Either literal text, or a replacement field if text is null.
+    struct Piece {
+        const char * text;
+        size_t length;
+        Spec spec;
+    };
+
+    explicit Parser(const char * pattern) : _pattern(pattern), _pos(pattern),
+            _next(0) {}
+
+    // Reads the next piece of the pattern. Returns false at its end.
+    bool next(Piece& piece) throw(IllegalArgumentException);
+
+private:
+    void parseField(Spec& spec) throw(IllegalArgumentException);
+    size_t parseNumber(size_t max) throw(IllegalArgumentException);
+    void fail(const char * reason) const throw(IllegalArgumentException);
+
+    const char * _pattern;
+    const char * _pos;
+    // the index of the next argument without an explicit index
+    size_t _next;
+};
+
+// The parser and writer functions on the path of every replacement field are
+// declared inline: in a shared library, calls to functions that aren't could
+// be interposed, so the compiler won't inline them.
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool isAlign(char c) {
+    return c == '<' || c == '>' || c == '^';
+}
+
+inline bool Format::Parser::next(Piece& piece)
+        throw(IllegalArgumentException) {
+    const char * start = _pos;
+    while (*_pos && *_pos != '{' && *_pos != '}') ++_pos;
+    piece.text = start;
+    piece.length = _pos - start;
+    if (piece.length != 0) return true;
+    if (!*_pos) return false;
+
+    if (_pos[0] == _pos[1]) {
+        // an escaped brace
+        piece.length = 1;
+        _pos += 2;
+        return true;
+    }
+    if (*_pos == '}') fail("Unmatched '}'");
+
+    ++_pos;
+    piece.text = null;
+    parseField(piece.spec);
+    return true;
+}
+
+inline void Format::Parser::parseField(Spec& spec)
+        throw(IllegalArgumentException) {
+    spec.width = 0;
+    spec.precision = NoPrecision;
+    spec.fill = ' ';
+    spec.align = 0;
+    spec.sign = '-';
+    spec.type = 0;
+    spec.alternate = false;
+    spec.zero = false;
+
+    spec.index = isDigit(*_pos) ? parseNumber(MaxWidth) : _next++;
+
+    if (*_pos == ':') {
+        ++_pos;
+        if (*_pos && *_pos != '{' && *_pos != '}' && isAlign(_pos[1])) {
+            if (*_pos & 0x80) fail("Non-ASCII fill character");
+            spec.fill = *_pos++;
+            spec.align = *_pos++;
+        } else if (isAlign(*_pos)) {
+            spec.align = *_pos++;
+        }
+        if (*_pos == '+' || *_pos == '-' || *_pos == ' ') spec.sign = *_pos++;
+        if (*_pos == '#') {
+            spec.alternate = true;
+            ++_pos;
+        }
+        if (*_pos == '0') {
+            spec.zero = true;
+            ++_pos;
+        }
+        if (isDigit(*_pos)) spec.width = parseNumber(MaxWidth);
+        if (*_pos == '.') {
+            ++_pos;
+            if (!isDigit(*_pos)) fail("Missing precision");
+            spec.precision = parseNumber(MaxWidth);
+        }
+        if (*_pos && std::strchr("bcdoxXeEfFgGs", *_pos)) spec.type = *_pos++;
+    }
+
+    if (*_pos != '}') fail(*_pos ? "Invalid replacement field" :
+            "Unterminated replacement field");
+    ++_pos;
+}
+
+inline size_t Format::Parser::parseNumber(size_t max)
+        throw(IllegalArgumentException) {
+    size_t n = 0;
+    while (isDigit(*_pos)) {
+        n = n * 10 + (*_pos - '0');
+        if (n > max) fail("Number too large");
+        ++_pos;
+    }
+    return n;
+}
+
+void Format::Parser::fail(const char * reason) const
+        throw(IllegalArgumentException) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s at position %u of format string",
+            reason, unsigned(_pos - _pattern));
+    sthrow(IllegalArgumentException, buf);
+}
+
+struct Format::Data {
+    explicit Data(const char * pattern) : refcount(1) {
+        size_t len = std::strlen(pattern);
+        this->pattern = Array<char>(len + 1);
+        std::memcpy(this->pattern.carray(), pattern, len + 1);
+    }
+
+    // the pieces point into this copy of the pattern
+    Array<char> pattern;
+    RefCount refcount;
+    Array<Parser::Piece> pieces;
+};
+
+// Writes the pieces of a pattern into a buffer. Everything that depends on
+// the kind of buffer is in grow(), units() and utf8(), which are
+// specialized below.
+template<class Buffer>
+class Format::Writer {
+public:
+    typedef typename std::conditional<std::is_same<Buffer,
+            StringBuffer>::value, uchar, char>::type Char;
+
+    explicit Writer(Buffer& out) : _out(out) {}
+
+    void write(const Parser::Piece& piece, const FormatArg * args,
+            size_t count) throw(IllegalArgumentException);
+
+private:
+    // Makes room for len more characters, and returns where they go.
+    Char * grow(size_t len);
+    // Takes back characters that grow() made room for, but were not used.
+    void shrink(size_t len);
+    void units(const uchar * src, size_t len);
+    void utf8(const char * src, size_t len);
+
+    void integer(const Parser::Spec& spec, bool negative, uint64_t magnitude)
+            throw(IllegalArgumentException);
+    void floating(const Parser::Spec& spec, double d, bool single)
+            throw(IllegalArgumentException);
+    void number(const Parser::Spec& spec, const char * head, size_t headLen,
+            const char * digits, size_t len, bool zeroes);
+    void string(const Parser::Spec& spec, const uchar * src, size_t len);
+    void string(const Parser::Spec& spec, const char * src, size_t len);
+    void codePoint(const Parser::Spec& spec, int64_t c)
+            throw(IllegalArgumentException);
+    void fill(char c, size_t len);
+    void wrongType(const Parser::Spec& spec) const
+            throw(IllegalArgumentException);
+
+    Buffer& _out;
+};
+
+template<>
+inline uchar * Format::Writer<StringBuffer>::grow(size_t len) {
+    return _out.extend(len);
+}
+
+template<>
+inline void Format::Writer<StringBuffer>::shrink(size_t len) {
+    _out._length -= len;
+    _out._gap = _out._length;
+}
+
+template<>
+inline void Format::Writer<StringBuffer>::units(const uchar * src, size_t len) {
+    _out.append(src, len);
+}
+
+template<>
+inline void Format::Writer<StringBuffer>::utf8(const char * src,
+        size_t len) {
+    // UTF-8 never takes fewer bytes than UTF-16 takes units
+    uchar * dest = grow(len);
+    idx_t i = 0;
+    while (i < len && !(src[i] & 0x80)) {
+        dest[i] = src[i];
+        ++i;
+    }
+    if (i < len) shrink(len - i - String::readUtf8(src + i, len - i,
+            dest + i));
+}
+
+template<>
+inline char * Format::Writer<Utf8Buffer>::grow(size_t len) {
+    _out.ensureCapacity(_out._length + len);
+    char * dest = reinterpret_cast<char*>(_out.buf.carray() + _out._length);
+    _out._length += len;
+    return dest;
+}
+
+template<>
+inline void Format::Writer<Utf8Buffer>::shrink(size_t len) {
+    _out._length -= len;
+}
+
+template<>
+inline void Format::Writer<Utf8Buffer>::units(const uchar * src, size_t len) {
+    _out.append(src, len);
+}
+
+template<>
+inline void Format::Writer<Utf8Buffer>::utf8(const char * src, size_t len) {
+    _out.append(src, len);
+}
+
+template<class Buffer>
+inline void Format::Writer<Buffer>::write(const Parser::Piece& piece,
+        const FormatArg * args, size_t count)
+        throw(IllegalArgumentException) {
+    if (piece.text) {
+        utf8(piece.text, piece.length);
+        return;
+    }
+
+    const Parser::Spec& spec = piece.spec;
+    if (spec.index >= count) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "Format: argument %u missing, %u given",
+                unsigned(spec.index), unsigned(count));
+        sthrow(IllegalArgumentException, buf);
+    }
+
+    const FormatArg& arg = args[spec.index];
+    const char type = spec.type;
+    switch (arg.type) {
+    case FormatArg::Bool:
+        if (!type || type == 's') {
+            if (arg.value.i) string(spec, "true", 4);
+            else string(spec, "false", 5);
+        } else {
+            integer(spec, false, arg.value.i);
+        }
+        break;
+    case FormatArg::Char:
+        if (!type || type == 's' || type == 'c') {
+            uchar c = uchar(arg.value.i);
+            string(spec, &c, 1);
+        } else {
+            integer(spec, false, arg.value.i);
+        }
+        break;
+    case FormatArg::Signed:
+        integer(spec, arg.value.i < 0, arg.value.i < 0 ?
+                -uint64_t(arg.value.i) : arg.value.i);
+        break;
+    case FormatArg::Unsigned:
+        integer(spec, false, arg.value.u);
+        break;
+    case FormatArg::Float:
+    case FormatArg::Double:
+        if (type && !std::strchr("eEfFgG", type)) wrongType(spec);
+        floating(spec, arg.value.d, arg.type == FormatArg::Float);
+        break;
+    case FormatArg::CString:
+        if (type && type != 's') wrongType(spec);
+        string(spec, arg.value.cstr, std::strlen(arg.value.cstr));
+        break;
+    case FormatArg::Units:
+        if (type && type != 's') wrongType(spec);
+        string(spec, arg.value.units.data, arg.value.units.length);
+        break;
+    }
+}
+
+// Splits padding before and after the text, according to the alignment.
+static inline void alignPadding(char align, size_t pad, size_t& before,
+        size_t& after) {
+    before = align == '<' ? 0 : align == '^' ? pad / 2 : pad;
+    after = pad - before;
+}
+
+template<class Buffer>
+inline void Format::Writer<Buffer>::integer(const Parser::Spec& spec,
+        bool negative, uint64_t magnitude) throw(IllegalArgumentException) {
+    if (spec.type == 's') wrongType(spec);
+    if (spec.type && std::strchr("eEfFgG", spec.type)) {
+        double d = double(magnitude);
+        floating(spec, negative ? -d : d, false);
+        return;
+    }
+    if (spec.precision != NoPrecision) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "Format: argument %u is an integer, "
+                "and cannot have a precision", unsigned(spec.index));
+        sthrow(IllegalArgumentException, buf);
+    }
+    if (spec.type == 'c') {
+        codePoint(spec, negative ? -int64_t(magnitude) : magnitude);
+        return;
+    }
+
+    char head[3] = { 0 };
+    size_t headLen = 0;
+    if (negative) head[headLen++] = '-';
+    else if (spec.sign != '-') head[headLen++] = spec.sign;
+
+    unsigned shift = 0;
+    const char * digits = lowerDigits;
+    switch (spec.type) {
+    case 'b': shift = 1; break;
+    case 'o': shift = 3; break;
+    case 'X': digits = upperDigits; // fall through
+    case 'x': shift = 4; break;
+    }
+    if (spec.alternate && shift != 0 && !(shift == 3 && magnitude == 0)) {
+        head[headLen++] = '0';
+        if (shift != 3) head[headLen++] = spec.type;
+    }
+
+    char buf[IntegerBufferSize];
+    char * end = buf + sizeof(buf);
+    char * p = end;
+    if (shift == 0) {
+        do {
+            *--p = char('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+    } else {
+        const unsigned mask = (1 << shift) - 1;
+        do {
+            *--p = digits[magnitude & mask];
+            magnitude >>= shift;
+        } while (magnitude);
+    }
+    number(spec, head, headLen, p, end - p, true);
+}
+
+template<class Buffer>
+void Format::Writer<Buffer>::floating(const Parser::Spec& spec, double d,
+        bool single) throw(IllegalArgumentException) {
+    bool finite = std::isfinite(d);
+    bool negative = std::signbit(d) && !std::isnan(d);
+    double magnitude = std::fabs(d);
+
+    char head[1] = { 0 };
+    size_t headLen = 0;
+    if (negative) head[headLen++] = '-';
+    else if (spec.sign != '-') head[headLen++] = spec.sign;
+
+    char buf[FloatBufferSize];
+    size_t len;
+    if (!finite || (!spec.type && spec.precision == NoPrecision)) {
+        // the shortest form that reads back as the same number
+        len = single ? formatFloat(float(magnitude), buf) :
+                formatFloat(magnitude, buf);
+    } else {
+        if (spec.precision != NoPrecision &&
+                spec.precision > MaxFloatPrecision) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Format: precision %u too large for "
+                    "argument %u", unsigned(spec.precision),
+                    unsigned(spec.index));
+            sthrow(IllegalArgumentException, msg);
+        }
+        // "%.*g", with the type, and a '#' for the alternate form
+        char fmt[6] = "%";
+        char * f = fmt + 1;
+        if (spec.alternate) *f++ = '#';
+        *f++ = '.';
+        *f++ = '*';
+        *f = spec.type ? spec.type : 'g';
+        len = snprintf(buf, sizeof(buf), fmt,
+                spec.precision == NoPrecision ? 6 : int(spec.precision),
+                magnitude);
+    }
+    number(spec, head, headLen, buf, len, finite);
+}
+
+template<class Buffer>
+inline void Format::Writer<Buffer>::number(const Parser::Spec& spec,
+        const char * head, size_t headLen, const char * digits, size_t len,
+        bool zeroes) {
+    size_t total = headLen + len;
+    size_t pad = spec.width > total ? spec.width - total : 0;
+    size_t before = 0, after = 0, zero = 0;
+    if (spec.zero && !spec.align && zeroes) zero = pad;
+    else alignPadding(spec.align ? spec.align : '>', pad, before, after);
+
+    Char * dest = grow(total + pad);
+    for (idx_t i = 0; i < before; ++i) *dest++ = spec.fill;
+    for (idx_t i = 0; i < headLen; ++i) *dest++ = head[i];
+    for (idx_t i = 0; i < zero; ++i) *dest++ = '0';
+    for (idx_t i = 0; i < len; ++i) *dest++ = digits[i];
+    for (idx_t i = 0; i < after; ++i) *dest++ = spec.fill;
+}
+
+template<class Buffer>
+inline void Format::Writer<Buffer>::string(const Parser::Spec& spec,
+        const uchar * src, size_t len) {
+    if (spec.precision < len) {
+        len = spec.precision;
+        // don't split a surrogate pair
+        if (len != 0 && (src[len - 1] & 0xFC00) == 0xD800) --len;
+    }
+    size_t pad = spec.width > len ? spec.width - len : 0;
+    size_t before, after;
+    alignPadding(spec.align ? spec.align : '<', pad, before, after);
+    fill(spec.fill, before);
+    units(src, len);
+    fill(spec.fill, after);
+}
+
+template<class Buffer>
+inline void Format::Writer<Buffer>::string(const Parser::Spec& spec,
+        const char * src, size_t len) {
+    if (spec.width == 0 && spec.precision == NoPrecision) {
+        utf8(src, len);
+        return;
+    }
+
+    // Count the UTF-16 units, stopping at the precision. A lead byte of a
+    // four byte sequence stands for a surrogate pair.
+    size_t units = 0;
+    idx_t end = 0;
+    for (; end < len; ++end) {
+        unsigned char c = src[end];
+        if ((c & 0xC0) == 0x80) continue;
+        size_t n = c >= 0xF0 ? 2 : 1;
+        if (units + n > spec.precision) break;
+        units += n;
+    }
+
+    size_t pad = spec.width > units ? spec.width - units : 0;
+    size_t before, after;
+    alignPadding(spec.align ? spec.align : '<', pad, before, after);
+    fill(spec.fill, before);
+    utf8(src, end);
+    fill(spec.fill, after);
+}
+
+template<class Buffer>
+void Format::Writer<Buffer>::codePoint(const Parser::Spec& spec, int64_t c)
+        throw(IllegalArgumentException) {
+    if (c < 0 || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "Format: argument %u is not a code point",
+                unsigned(spec.index));
+        sthrow(IllegalArgumentException, buf);
+    }
+    uchar pair[2];
+    size_t len = 1;
+    if (c >= 0x10000) {
+        c -= 0x10000;
+        pair[0] = uchar(0xD800 | (c >> 10));
+        pair[1] = uchar(0xDC00 | (c & 0x3FF));
+        len = 2;
+    } else {
+        pair[0] = uchar(c);
+    }
+    Parser::Spec plain = spec;
+    plain.precision = NoPrecision;
+    string(plain, pair, len);
+}
+
+template<class Buffer>
+inline void Format::Writer<Buffer>::fill(char c, size_t len) {
+    if (len == 0) return;
+    Char * dest = grow(len);
+    for (idx_t i = 0; i < len; ++i) dest[i] = c;
+}
+
+template<class Buffer>
+void Format::Writer<Buffer>::wrongType(const Parser::Spec& spec) const
+        throw(IllegalArgumentException) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Format: type '%c' does not apply to "
+            "argument %u", spec.type, unsigned(spec.index));
+    sthrow(IllegalArgumentException, buf);
+}
+
+Format::Format(const char* pattern) throw(IllegalArgumentException) :
+        data(new Data(pattern)) {
+    try {
+        Vector<Parser::Piece> pieces;
+        Parser parser(data->pattern.carray());
+        Parser::Piece piece;
+        while (parser.next(piece)) pieces.add(piece);
+        data->pieces = pieces.toArray();
+    } catch (...) {
+        delete data;
+        throw;
+    }
+}
+
+Format::Format(const Format& other) : data(other.data) {
+    data->refcount.acquire();
+}
+
+Format::~Format() {
+    if (data->refcount.release()) delete data;
+}
+
+Format& Format::operator=(const Format& other) {
+    if (data == other.data) return *this;
+    other.data->refcount.acquire();
+    if (data->refcount.release()) delete data;
+    data = other.data;
+    return *this;
+}
+
+void Format::write(StringBuffer& out, const FormatArg* args, size_t count)
+        const throw(IllegalArgumentException) {
+    Writer<StringBuffer> writer(out);
+    const Parser::Piece * pieces = data->pieces.carray();
+    for (idx_t i = 0; i < data->pieces.length; ++i) {
+        writer.write(pieces[i], args, count);
+    }
+}
+
+void Format::write(Utf8Buffer& out, const FormatArg* args, size_t count)
+        const throw(IllegalArgumentException) {
+    Writer<Utf8Buffer> writer(out);
+    const Parser::Piece * pieces = data->pieces.carray();
+    for (idx_t i = 0; i < data->pieces.length; ++i) {
+        writer.write(pieces[i], args, count);
+    }
+}
+
+void Format::vformat(StringBuffer& out, const char* pattern,
+        const FormatArg* args, size_t count)
+        throw(IllegalArgumentException) {
+    Writer<StringBuffer> writer(out);
+    Parser parser(pattern);
+    Parser::Piece piece;
+    while (parser.next(piece)) writer.write(piece, args, count);
+}
+
+void Format::vformat(Utf8Buffer& out, const char* pattern,
+        const FormatArg* args, size_t count)
+        throw(IllegalArgumentException) {
+    Writer<Utf8Buffer> writer(out);
+    Parser parser(pattern);
+    Parser::Piece piece;
+    while (parser.next(piece)) writer.write(piece, args, count);
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
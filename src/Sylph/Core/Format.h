@@ -0,0 +1,347 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_FORMAT_H_
+#define SYLPH_CORE_FORMAT_H_
+
+#include "Object.h"
+#include "Exception.h"
+#include "Primitives.h"
+#include "String.h"
+#include "StringBuffer.h"
+#include "StringView.h"
+#include "Utf8Buffer.h"
+
+#include <type_traits>
+#include <utility>
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * One argument of format(). FormatArgs are created implicitly from the
+ * arguments passed to format() and Format, there is no need to create them
+ * directly. A FormatArg only refers to its value, it does not copy it.<p>
+ * The supported types are @c bool, @c char, all integer types, @c float,
+ * @c double, C strings (taken to be UTF-8), String, StringView and
+ * StringLiteral. Passing anything else does not compile. A @c char is the
+ * character U+0000 to U+00FF with the same, unsigned, value, as it is for
+ * StringBuffer and Utf8Buffer.
+ */
+class FormatArg {
+public:
+    /** The kind of value this FormatArg refers to. */
+    enum Type {
+        Bool, Char, Signed, Unsigned, Float, Double, CString, Units
+    };
+
+    /** */
+    FormatArg() : type(Bool) {
+        value.i = 0;
+    }
+    /** */
+    FormatArg(bool b) : type(Bool) {
+        value.i = b;
+    }
+    /** */
+    FormatArg(char c) : type(Char) {
+        value.i = static_cast<unsigned char>(c);
+    }
+    /** */
+    template<class T>
+    FormatArg(T i, typename std::enable_if<std::is_integral<T>::value &&
+            std::is_signed<T>::value>::type* = 0) : type(Signed) {
+        value.i = i;
+    }
+    /** */
+    template<class T>
+    FormatArg(T u, typename std::enable_if<std::is_integral<T>::value &&
+            std::is_unsigned<T>::value>::type* = 0) : type(Unsigned) {
+        value.u = u;
+    }
+    /** */
+    FormatArg(float f) : type(Float) {
+        value.d = f;
+    }
+    /** */
+    FormatArg(double d) : type(Double) {
+        value.d = d;
+    }
+    /** */
+    FormatArg(const char* s) : type(CString) {
+        value.cstr = s;
+    }
+    /**
+     * Other pointers are not supported; without this, they would silently be
+     * taken for a bool.
+     */
+    template<class T>
+    FormatArg(const T* p) = delete;
+    /**
+     * Only takes Strings themselves: anything that merely converts to a
+     * String would be converted into a temporary that is gone before the
+     * argument is used.
+     */
+    template<class T>
+    FormatArg(const T& s, typename std::enable_if<
+            std::is_same<T, String>::value>::type* = 0) : type(Units) {
+        value.units.data = s.rawdata();
+        value.units.length = s.length();
+    }
+    /** */
+    FormatArg(const StringLiteral& s) : type(Units) {
+        value.units.data = reinterpret_cast<const uchar*>(s.units);
+        value.units.length = s.length;
+    }
+    /** */
+    FormatArg(const StringView& v) : type(Units) {
+        value.units.data = v.data();
+        value.units.length = v.length();
+    }
+
+    /** The kind of value. */
+    Type type;
+    /** The value, depending on the type. */
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char* cstr;
+        struct {
+            const uchar* data;
+            size_t length;
+        } units;
+    } value;
+};
+
+/**
+ * A pre-parsed format string. The syntax is the one of Python's
+ * <code>str.format()</code> and of the fmt library: the format string is
+ * copied as it is, except for replacement fields in braces, which are
+ * replaced by the formatted arguments. A brace is written by doubling it.
+ * A replacement field looks as follows, all parts being optional:
+ * <pre>{index:[[fill]align][sign][#][0][width][.precision][type]}</pre>
+ * <ul>
+ * <li><em>index</em> picks the argument; without it, the arguments are taken
+ * in order.</li>
+ * <li><em>align</em> is one of <code>&lt;</code>, <code>&gt;</code> and
+ * <code>^</code>, for left, right and centered alignment within
+ * <em>width</em>. The <em>fill</em> character, a space by default, has to be
+ * ASCII. Numbers are aligned right by default, everything else left.</li>
+ * <li><em>sign</em> is <code>+</code> to always write a sign, a space to
+ * write a space for positive numbers, or <code>-</code>, the default.</li>
+ * <li><code>#</code> adds a prefix to binary, octal and hexadecimal
+ * numbers.</li>
+ * <li><code>0</code> pads numbers with zeroes after the sign.</li>
+ * <li><em>width</em> is the minimal amount of characters to write. Lengths
+ * are counted in UTF-16 units, like everywhere else in String.</li>
+ * <li><em>precision</em> is the amount of digits after the point for
+ * floating point numbers, or the maximal amount of characters to take from
+ * a string.</li>
+ * <li><em>type</em> is <code>d</code> (decimal), <code>x</code>,
+ * <code>X</code> (hexadecimal), <code>o</code> (octal), <code>b</code>
+ * (binary) or <code>c</code> (the character with that code point) for
+ * integers, and <code>f</code>, <code>e</code>, <code>g</code> or their
+ * uppercase versions for floating point numbers, as for @c printf. Without
+ * a type, integers are written in decimal, and floating point numbers in
+ * the shortest form that reads back as the same number.</li>
+ * </ul>
+ * Nothing is allocated while formatting, apart from growing the buffer that
+ * is written to: digits are written straight into it, and no temporary
+ * Strings are created. A Format parses its format string only once, so it
+ * is the faster choice when the same format string is used over and over;
+ * the format() functions parse the format string while they write.<p>
+ * An example:
+ * <pre>Format line("{:>8}: {:08x}");
+ * StringBuffer buf;
+ * line.format(buf, name, crc);</pre>
+ */
+class Format : public virtual Object {
+public:
+    /**
+     * Parses a format string.
+     * @param pattern The format string, in UTF-8.
+     * @throw IllegalArgumentException If the format string is not valid.
+     */
+    explicit Format(const char* pattern) throw(IllegalArgumentException);
+    /** */
+    Format(const Format& other);
+    /** */
+    virtual ~Format();
+    /** */
+    Format& operator=(const Format& other);
+
+    /**
+     * Appends the formatted arguments to a StringBuffer.
+     * @param out The StringBuffer to append to.
+     * @param args The arguments.
+     * @return @em out.
+     * @throw IllegalArgumentException If an argument is missing, or does not
+     * support the type in its replacement field.
+     */
+    template<class... Args>
+    StringBuffer& format(StringBuffer& out, const Args&... args) const {
+        const FormatArg list[] = { FormatArg(args)..., FormatArg() };
+        write(out, list, sizeof...(Args));
+        return out;
+    }
+
+    /**
+     * Appends the formatted arguments to a Utf8Buffer.
+     * @see format(StringBuffer&, const Args&...)
+     */
+    template<class... Args>
+    Utf8Buffer& format(Utf8Buffer& out, const Args&... args) const {
+        const FormatArg list[] = { FormatArg(args)..., FormatArg() };
+        write(out, list, sizeof...(Args));
+        return out;
+    }
+
+    /**
+     * Writes the formatted arguments to an OutputStream, in UTF-8.
+     * @see format(StringBuffer&, const Args&...)
+     */
+    template<class... Args>
+    OutputStream& format(OutputStream& out, const Args&... args) const {
+        Utf8Buffer buf;
+        format(buf, args...);
+        return out << buf;
+    }
+
+    /**
+     * Returns the formatted arguments as a String.
+     * @see format(StringBuffer&, const Args&...)
+     */
+    template<class... Args>
+    String toString(const Args&... args) const {
+        StringBuffer buf;
+        format(buf, args...);
+        return std::move(buf).toString();
+    }
+
+    /**
+     * Appends formatted arguments to a StringBuffer. This is what the
+     * templates above come down to.
+     * @param out The StringBuffer to append to.
+     * @param args The arguments.
+     * @param count The amount of arguments.
+     */
+    void write(StringBuffer& out, const FormatArg* args, size_t count) const
+            throw(IllegalArgumentException);
+    /**
+     * Appends formatted arguments to a Utf8Buffer.
+     * @see write(StringBuffer&, const FormatArg*, size_t)
+     */
+    void write(Utf8Buffer& out, const FormatArg* args, size_t count) const
+            throw(IllegalArgumentException);
+
+    /**
+     * Appends formatted arguments to a StringBuffer, parsing the format
+     * string on the way. This is what format() comes down to.
+     * @param out The StringBuffer to append to.
+     * @param pattern The format string.
+     * @param args The arguments.
+     * @param count The amount of arguments.
+     */
+    static void vformat(StringBuffer& out, const char* pattern,
+            const FormatArg* args, size_t count)
+            throw(IllegalArgumentException);
+    /**
+     * Appends formatted arguments to a Utf8Buffer, parsing the format
+     * string on the way.
+     * @see vformat(StringBuffer&, const char*, const FormatArg*, size_t)
+     */
+    static void vformat(Utf8Buffer& out, const char* pattern,
+            const FormatArg* args, size_t count)
+            throw(IllegalArgumentException);
+
+private:
+    struct Data;
+    class Parser;
+    template<class Buffer> class Writer;
+
+    Data * data;
+};
+
+/**
+ * Appends formatted arguments to a StringBuffer. See Format for the syntax
+ * of the format string.
+ * <pre>format(buf, "{}: {:08x}\n", name, crc);</pre>
+ * @param out The StringBuffer to append to.
+ * @param pattern The format string, in UTF-8.
+ * @param args The arguments.
+ * @return @em out.
+ * @throw IllegalArgumentException If the format string is not valid, an
+ * argument is missing, or does not support the type in its replacement
+ * field.
+ */
+template<class... Args>
+StringBuffer& format(StringBuffer& out, const char* pattern,
+        const Args&... args) {
+    const FormatArg list[] = { FormatArg(args)..., FormatArg() };
+    Format::vformat(out, pattern, list, sizeof...(Args));
+    return out;
+}
+
+/**
+ * Appends formatted arguments to a Utf8Buffer.
+ * @see format(StringBuffer&, const char*, const Args&...)
+ */
+template<class... Args>
+Utf8Buffer& format(Utf8Buffer& out, const char* pattern,
+        const Args&... args) {
+    const FormatArg list[] = { FormatArg(args)..., FormatArg() };
+    Format::vformat(out, pattern, list, sizeof...(Args));
+    return out;
+}
+
+/**
+ * Writes formatted arguments to an OutputStream, in UTF-8.
+ * @see format(StringBuffer&, const char*, const Args&...)
+ */
+template<class... Args>
+OutputStream& format(OutputStream& out, const char* pattern,
+        const Args&... args) {
+    Utf8Buffer buf;
+    format(buf, pattern, args...);
+    return out << buf;
+}
+
+/**
+ * Returns formatted arguments as a String.
+ * <pre>String s = format("{} of {}", done, total);</pre>
+ * @see format(StringBuffer&, const char*, const Args&...)
+ */
+template<class... Args>
+String format(const char* pattern, const Args&... args) {
+    StringBuffer buf;
+    format(buf, pattern, args...);
+    return std::move(buf).toString();
+}
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_FORMAT_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -301,13 +301,10 @@ public:
     Value * get(Key key) {
         int h = hash(key);
         EntryPtr entry = buckets[h];
-        if (entry == null) {
-            return null;
-        }
-        do {
+        while (entry != null) {
             if (entry->key == key) return entry->value;
             entry = entry->next;
-        } while (entry->next != null);
+        }
         return null;
     }
 
@@ -320,13 +317,10 @@ public:
     const Value * get(Key key) const {
         int h = hash(key);
         EntryPtr entry = buckets[h];
-        if (entry == null) {
-            return null;
-        }
-        do {
+        while (entry != null) {
             if (entry->key == key) return entry->value;
             entry = entry->next;
-        } while (entry->next != null);
+        }
         return null;
     }
 
@@ -0,0 +1,132 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_NUMBERFORMAT_H_
+#define SYLPH_CORE_NUMBERFORMAT_H_
+
+#include "Primitives.h"
+
+SYLPH_BEGIN_NAMESPACE
+typedef uint16_t uchar;
+
+/**
+ * The size of a buffer that can hold any number formatted by one of the
+ * format functions below.
+ */
+const size_t NumberBufferSize = 32;
+
+/**
+ * Writes the decimal representation of an integer into a buffer. Digits are
+ * written two at a time, using a lookup table. No terminating NUL is
+ * written.
+ * @param i The integer to format.
+ * @param buf A buffer of at least NumberBufferSize characters.
+ * @return The amount of characters written.
+ */
+size_t formatInteger(int64_t i, char* buf);
+
+/**
+ * Writes the decimal representation of an unsigned integer into a buffer.
+ * @see formatInteger(int64_t, char*)
+ */
+size_t formatInteger(uint64_t i, char* buf);
+
+/**
+ * Writes the shortest decimal representation of a double into a buffer that
+ * still reads back as exactly the same double. The digits are generated with
+ * the Ryu algorithm; if several representations are equally short, the one
+ * closest to the double is taken. The layout follows @c printf's
+ * <code>%.16g</code> (<code>%.7g</code> for floats): the exponential notation
+ * (e.g. <code>1e+20</code>) is only used for very small or very large
+ * numbers. Infinities and NaN are written as @c Infinity, @c -Infinity and
+ * @c NaN. No terminating NUL is written.
+ * @param d The double to format.
+ * @param buf A buffer of at least NumberBufferSize characters.
+ * @return The amount of characters written.
+ */
+size_t formatFloat(double d, char* buf);
+
+/**
+ * Writes the shortest decimal representation of a float into a buffer that
+ * still reads back as exactly the same float.
+ * @see formatFloat(double, char*)
+ */
+size_t formatFloat(float f, char* buf);
+
+/**
+ * The outcome of one of the parse functions below.
+ */
+enum ParseResult {
+    ParseOk, /**< The whole input was a number that fits the type. */
+    ParseInvalid, /**< The input was not a number. */
+    ParseOutOfRange /**< The input was a number that does not fit the type.*/
+};
+
+/**
+ * Parses a signed decimal integer from a UTF-16 buffer. The buffer has to
+ * match <code>[+-]?[0-9]+</code> in its entirety; no whitespace is skipped.
+ * The locale is not taken into account.
+ * @param str The first character to parse.
+ * @param len The amount of characters to parse.
+ * @param out Receives the value, only if ParseOk is returned.
+ * @return ParseOk, or the reason the buffer could not be parsed.
+ */
+ParseResult parseInteger(const uchar* str, size_t len, int64_t& out);
+
+/**
+ * Parses an unsigned decimal integer from a UTF-16 buffer. The buffer has to
+ * match <code>+?[0-9]+</code> in its entirety.
+ * @see parseInteger(const uchar*, size_t, int64_t&)
+ */
+ParseResult parseInteger(const uchar* str, size_t len, uint64_t& out);
+
+/**
+ * Parses a decimal floating point number from a UTF-16 buffer. The buffer has
+ * to match <code>[+-]?([0-9]+(\.[0-9]*)?|\.[0-9]+)([eE][+-]?[0-9]+)?</code>,
+ * or be one of @c NaN, @c Infinity or @c -Infinity, as written by
+ * formatFloat(). The result is correctly rounded: the significand is
+ * multiplied by a 128-bit power of five (Eisel-Lemire), and only if that is
+ * inconclusive, which takes more than 19 significant digits, does the
+ * parser fall back to the C library. The locale is not taken into account.
+ * Numbers too large for the type give ParseOutOfRange; numbers too small
+ * for it give zero.
+ * @param str The first character to parse.
+ * @param len The amount of characters to parse.
+ * @param out Receives the value, only if ParseOk is returned.
+ * @return ParseOk, or the reason the buffer could not be parsed.
+ */
+ParseResult parseFloat(const uchar* str, size_t len, double& out);
+
+/**
+ * Parses a decimal floating point number into a float, rounding only once.
+ * @see parseFloat(const uchar*, size_t, double&)
+ */
+ParseResult parseFloat(const uchar* str, size_t len, float& out);
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_NUMBERFORMAT_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
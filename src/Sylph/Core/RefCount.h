@@ -0,0 +1,125 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_REFCOUNT_H_
+#define	SYLPH_CORE_REFCOUNT_H_
+
+#include "Object.h"
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A reference count, as used by the shared data of String and Array. A new
+ * RefCount starts at 1, i.e. owned by the object that created it.<p>
+ * By default, the count is a plain integer and objects sharing data must not
+ * be used from multiple threads at the same time. When LibSylph is built with
+ * @c SYLPH_ATOMIC_REFCOUNT (<code>-DSYLPH_ATOMIC_REFCOUNT=1</code> to cmake),
+ * the count is updated atomically, allowing copies of the same String or Array
+ * to be created and destroyed from different threads. The contents themselves
+ * are not protected in either mode.
+ */
+class RefCount {
+public:
+    /**
+     * Creates a new reference count with given initial value.
+     * @param initial The initial count, 1 by default.
+     */
+    explicit RefCount(size_t initial = 1) : count(initial) {}
+
+    /**
+     * Increases the reference count by one.
+     */
+    inline void acquire() {
+#ifdef SYLPH_ATOMIC_REFCOUNT
+        // A new reference can only be made from an existing one, so no
+        // ordering is required here.
+        count.fetch_add(1, std::memory_order_relaxed);
+#else
+        ++count;
+#endif
+    }
+
+    /**
+     * Decreases the reference count by one.
+     * @return @em true if this was the last reference, i.e. if the shared data
+     * should be destroyed by the caller, @em false otherwise.
+     */
+    inline bool release() {
+#ifdef SYLPH_ATOMIC_REFCOUNT
+        if (count.fetch_sub(1, std::memory_order_release) == 1) {
+            // make all writes of other owners visible before destruction
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+        return false;
+#else
+        return --count == 0;
+#endif
+    }
+
+    /**
+     * Returns the current count. In atomic mode, the value may already be
+     * outdated when it is returned, unless the caller holds the only
+     * reference.
+     */
+    inline size_t get() const {
+#ifdef SYLPH_ATOMIC_REFCOUNT
+        return count.load(std::memory_order_relaxed);
+#else
+        return count;
+#endif
+    }
+
+    /**
+     * Checks whether there are no other references than the caller's.
+     */
+    inline bool unique() const {
+#ifdef SYLPH_ATOMIC_REFCOUNT
+        return count.load(std::memory_order_acquire) == 1;
+#else
+        return count == 1;
+#endif
+    }
+
+private:
+    RefCount(const RefCount&);
+    RefCount& operator=(const RefCount&);
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    std::atomic<size_t> count;
+#else
+    size_t count;
+#endif
+};
+
+SYLPH_END_NAMESPACE
+
+#endif	/* SYLPH_CORE_REFCOUNT_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
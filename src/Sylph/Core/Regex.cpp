@@ -0,0 +1,1319 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "Regex.h"
+#include "RefCount.h"
+#include "Util.h"
+#include "Vector.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+#include <mutex>
+#endif
+
+SYLPH_BEGIN_NAMESPACE
+
+// Limits that keep compiling and matching bounded.
+static const uint32_t MaxRepeat = 1000;
+static const size_t MaxInstructions = 100000;
+static const uint32_t MaxNesting = 1000;
+static const uint32_t MaxGroups = 1000;
+// The NFA keeps the captures of every thread, and there can be a thread for
+// every OpClass and OpMatch instruction. This caps threads * slots.
+static const size_t MaxCaptureSlots = size_t(1) << 21;
+static const size_t MaxDfaStates = 4096;
+static const uint32_t MaxCodePoint = 0x10FFFF;
+static const uint32_t Infinite = uint32_t(-1);
+
+enum Opcode {
+    OpClass,  // consume a code point in ranges x to x + y
+    OpSplit,  // continue at x, or with lower priority at y
+    OpJump,   // continue at x
+    OpSave,   // store the current position in slot x
+    OpBegin,  // assert the start of the text
+    OpEnd,    // assert the end of the text
+    OpMatch
+};
+
+struct Inst {
+    Opcode op;
+    uint32_t x;
+    uint32_t y;
+};
+
+struct CodeRange {
+    uint32_t lo;
+    uint32_t hi;
+};
+
+static bool operator<(const CodeRange& lhs, const CodeRange& rhs) {
+    return lhs.lo < rhs.lo;
+}
+
+// Decodes the code point at text[pos], and stores the amount of units it
+// takes in width. Unpaired surrogates are code points of their own.
+static inline uint32_t decodeAt(const uchar * text, size_t len, size_t pos,
+        size_t& width) {
+    uchar c = text[pos];
+    if ((c & 0xFC00) == 0xD800 && pos + 1 < len &&
+            (text[pos + 1] & 0xFC00) == 0xDC00) {
+        width = 2;
+        return 0x10000 + (((c & 0x3FF) << 10) | (text[pos + 1] & 0x3FF));
+    }
+    width = 1;
+    return c;
+}
+
+// Grows a to hold at least needed elements, filling new ones with fill.
+template<class T>
+static void reserve(Array<T>& a, size_t needed, const T& fill) {
+    if (a.length >= needed) return;
+    size_t len = a.length ? a.length : 16;
+    while (len < needed) len <<= 1;
+    Array<T> grown(len);
+    carraycopy(a.carray(), 0, grown.carray(), 0, a.length);
+    for (size_t i = a.length; i < len; ++i) grown.carray()[i] = fill;
+    a = std::move(grown);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// A DFA that is built while it runs. Every state is a set of instructions,
+// namely the OpClass, OpEnd and OpMatch instructions that are alive.
+struct Dfa {
+    Dfa() : states(0) {
+        start[0] = start[1] = -1;
+    }
+
+    size_t states;
+    // start state when at the start of the text, and when not
+    int32_t start[2];
+    // the instructions of state s are pool[setStart[s]] to
+    // pool[setStart[s + 1]]
+    Array<uint32_t> pool;
+    Array<uint32_t> setStart;
+    // the state after state s on character class c is
+    // next[s * classes + c], or -1 if not computed yet
+    Array<int32_t> next;
+    Array<byte> hasMatch;
+    // open addressing over state numbers, -1 for empty slots
+    Array<int32_t> table;
+};
+
+enum DfaResult {
+    DfaNoMatch,
+    DfaMatch,
+    // too many states; the NFA has to be used instead
+    DfaGaveUp
+};
+
+struct NfaFrame {
+    uint32_t pc;
+    // if not -1, restore slot to old instead of following pc
+    int32_t slot;
+    sidx_t old;
+};
+
+struct Regex::Data {
+    Data(const String pattern) : pattern(pattern), refcount(1), groups(0),
+            threads(0), generation(0), nfaGeneration(0) {}
+
+    String pattern;
+    RefCount refcount;
+    size_t groups;
+    // the amount of OpClass and OpMatch instructions, which bounds the
+    // amount of threads the NFA runs at once
+    size_t threads;
+
+    Array<Inst> program;
+    // lo, hi pairs, referred to by OpClass
+    Array<uint32_t> ranges;
+    // for every instruction, a bitmap of the ASCII characters it matches
+    Array<uint32_t> ascii;
+
+    // The code points split up in classes that no instruction can tell
+    // apart. Class c starts at bounds[c].
+    Array<uint32_t> bounds;
+    Array<uint32_t> asciiClass;
+
+    // The ASCII characters a match can start with, and whether it can start
+    // with anything else. Only valid if canSkip is set, which it isn't when
+    // the empty string matches, or the pattern starts with an anchor.
+    uint32_t firstAscii[4];
+    bool firstOther;
+    bool canSkip;
+
+    // Everything below is only used while holding the lock.
+    mutable Dfa anchored;
+    mutable Dfa unanchored;
+    mutable Array<uint32_t> mark;
+    mutable uint32_t generation;
+    mutable Array<uint32_t> stack;
+    mutable Array<uint32_t> set;
+    mutable size_t setSize;
+    // The scratch memory of runNfa(), allocated by its first run: the pcs of
+    // both thread lists, then their marks; the captures of both lists, then
+    // of the thread being added; the stack of addThread().
+    mutable Array<uint32_t> nfaInts;
+    mutable Array<sidx_t> nfaCaps;
+    mutable Array<NfaFrame> nfaStack;
+    mutable uint32_t nfaGeneration;
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    mutable std::mutex lock;
+#endif
+
+    void prepare();
+    inline bool canStart(uint32_t cp) const;
+    inline bool inClass(uint32_t pc, uint32_t cp) const;
+    inline uint32_t classOf(uint32_t cp) const;
+
+    void newSet() const;
+    void follow(uint32_t pc, bool atBegin, bool atEnd) const;
+    int32_t addState(Dfa& dfa) const;
+    int32_t transition(Dfa& dfa, int32_t s, uint32_t c, bool search) const;
+    bool acceptsAtEnd(const Dfa& dfa, int32_t s, bool atBegin) const;
+    DfaResult runDfa(Dfa& dfa, const uchar * text, size_t len, size_t from,
+            bool search) const;
+
+    bool runNfa(const uchar * text, size_t len, size_t from, bool search,
+            sidx_t * slots) const;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Parses a pattern and compiles it into the program of a Regex::Data.
+class Regex::Compiler {
+public:
+    Compiler(const String pattern, Regex::Data& data) :
+            _pattern(pattern.utf16()), _text(_pattern.carray()),
+            _length(_pattern.length), _pos(0), _depth(0), _groups(0),
+            _data(data) {}
+
+    void compile();
+
+private:
+    struct Node {
+        enum Kind { Empty, Set, Concat, Alternate, Repeat, Group, Begin, End };
+        Kind kind;
+        int32_t child;
+        int32_t next;
+        // Set: the ranges in _ranges
+        uint32_t first;
+        uint32_t count;
+        // Repeat
+        uint32_t min;
+        uint32_t max;
+        bool greedy;
+        // Group: the capture group, -1 if it doesn't capture
+        int32_t group;
+    };
+
+    // A set of code points, as ranges that are sorted and merged by
+    // normalize().
+    class CharSet {
+    public:
+        void add(uint32_t lo, uint32_t hi) {
+            CodeRange r = { lo, hi };
+            ranges.add(r);
+        }
+        void add(const CharSet& other) {
+            for (idx_t i = 0; i < other.ranges.size(); ++i) {
+                ranges.add(other.ranges.get(i));
+            }
+        }
+        void normalize();
+        void negate();
+
+        Vector<CodeRange> ranges;
+    };
+
+    void fail(const char * reason) const throw(ParseException);
+    bool more() const {
+        return _pos < _length;
+    }
+    uint32_t peek() const;
+    uint32_t next();
+    bool accept(uint32_t c);
+
+    int32_t node(Node::Kind kind);
+    int32_t setNode(CharSet& set);
+    int32_t parseAlternation();
+    int32_t parseConcat();
+    int32_t parseRepeat();
+    bool parseCount(uint32_t& min, uint32_t& max);
+    uint32_t parseNumber();
+    int32_t parseAtom();
+    int32_t parseClass();
+    void parseEscape(CharSet& set);
+    uint32_t parseHex(size_t digits);
+
+    uint32_t emit(Opcode op, uint32_t x = 0, uint32_t y = 0);
+    uint32_t pc() const {
+        return _program.size();
+    }
+    void compile(int32_t n);
+
+    Array<uchar> _pattern;
+    const uchar * _text;
+    size_t _length;
+    size_t _pos;
+    uint32_t _depth;
+    uint32_t _groups;
+    Vector<Node> _nodes;
+    Vector<uint32_t> _ranges;
+    Vector<Inst> _program;
+    Regex::Data& _data;
+};
+
+void Regex::Compiler::CharSet::normalize() {
+    Array<CodeRange> sorted = ranges.toArray();
+    std::sort(sorted.carray(), sorted.carray() + sorted.length);
+    ranges.clear();
+    for (idx_t i = 0; i < sorted.length; ++i) {
+        CodeRange r = sorted[i];
+        if (!ranges.empty()) {
+            CodeRange& last = ranges.get(ranges.size() - 1);
+            if (r.lo <= last.hi + 1) {
+                if (r.hi > last.hi) last.hi = r.hi;
+                continue;
+            }
+        }
+        ranges.add(r);
+    }
+}
+
+void Regex::Compiler::CharSet::negate() {
+    // Expects a normalized set.
+    Vector<CodeRange> negated;
+    uint32_t lo = 0;
+    for (idx_t i = 0; i < ranges.size(); ++i) {
+        const CodeRange& r = ranges.get(i);
+        if (r.lo > lo) {
+            CodeRange gap = { lo, r.lo - 1 };
+            negated.add(gap);
+        }
+        lo = r.hi + 1;
+    }
+    if (lo <= MaxCodePoint) {
+        CodeRange gap = { lo, MaxCodePoint };
+        negated.add(gap);
+    }
+    ranges = std::move(negated);
+}
+
+void Regex::Compiler::fail(const char * reason) const throw(ParseException) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s at position %u of regular expression",
+            reason, unsigned(_pos));
+    sthrow(ParseException, buf);
+}
+
+uint32_t Regex::Compiler::peek() const {
+    size_t width;
+    return decodeAt(_text, _length, _pos, width);
+}
+
+uint32_t Regex::Compiler::next() {
+    size_t width;
+    uint32_t c = decodeAt(_text, _length, _pos, width);
+    _pos += width;
+    return c;
+}
+
+bool Regex::Compiler::accept(uint32_t c) {
+    if (more() && _text[_pos] == c) {
+        ++_pos;
+        return true;
+    }
+    return false;
+}
+
+int32_t Regex::Compiler::node(Node::Kind kind) {
+    Node n;
+    n.kind = kind;
+    n.child = n.next = -1;
+    n.first = n.count = 0;
+    n.min = n.max = 0;
+    n.greedy = true;
+    n.group = -1;
+    _nodes.add(n);
+    return _nodes.size() - 1;
+}
+
+int32_t Regex::Compiler::setNode(CharSet& set) {
+    set.normalize();
+    int32_t n = node(Node::Set);
+    _nodes.get(n).first = _ranges.size() / 2;
+    _nodes.get(n).count = set.ranges.size();
+    for (idx_t i = 0; i < set.ranges.size(); ++i) {
+        _ranges.add(set.ranges.get(i).lo);
+        _ranges.add(set.ranges.get(i).hi);
+    }
+    return n;
+}
+
+int32_t Regex::Compiler::parseAlternation() {
+    int32_t first = parseConcat();
+    if (!more() || peek() != '|') return first;
+    int32_t alt = node(Node::Alternate);
+    _nodes.get(alt).child = first;
+    int32_t last = first;
+    while (accept('|')) {
+        int32_t n = parseConcat();
+        _nodes.get(last).next = n;
+        last = n;
+    }
+    return alt;
+}
+
+int32_t Regex::Compiler::parseConcat() {
+    int32_t cat = node(Node::Concat);
+    int32_t last = -1;
+    while (more() && peek() != '|' && peek() != ')') {
+        int32_t n = parseRepeat();
+        if (last == -1) _nodes.get(cat).child = n;
+        else _nodes.get(last).next = n;
+        last = n;
+    }
+    return cat;
+}
+
+int32_t Regex::Compiler::parseRepeat() {
+    int32_t atom = parseAtom();
+    if (!more()) return atom;
+
+    uint32_t min, max;
+    size_t start = _pos;
+    switch (peek()) {
+    case '*':
+        min = 0;
+        max = Infinite;
+        ++_pos;
+        break;
+    case '+':
+        min = 1;
+        max = Infinite;
+        ++_pos;
+        break;
+    case '?':
+        min = 0;
+        max = 1;
+        ++_pos;
+        break;
+    case '{':
+        // Like in Perl, a brace that doesn't start a count is a literal.
+        if (!parseCount(min, max)) {
+            _pos = start;
+            return atom;
+        }
+        break;
+    default:
+        return atom;
+    }
+
+    Node::Kind kind = _nodes.get(atom).kind;
+    if (kind == Node::Begin || kind == Node::End) {
+        _pos = start;
+        fail("Nothing to repeat");
+    }
+    bool greedy = !accept('?');
+    if (more() && (peek() == '*' || peek() == '+' || peek() == '?')) {
+        fail("Nested quantifier");
+    }
+
+    int32_t rep = node(Node::Repeat);
+    Node& n = _nodes.get(rep);
+    n.child = atom;
+    n.min = min;
+    n.max = max;
+    n.greedy = greedy;
+    return rep;
+}
+
+bool Regex::Compiler::parseCount(uint32_t& min, uint32_t& max) {
+    // Expects to be at the opening brace.
+    ++_pos;
+    if (!more() || peek() < '0' || peek() > '9') return false;
+    min = max = parseNumber();
+    if (accept(',')) {
+        if (more() && peek() >= '0' && peek() <= '9') max = parseNumber();
+        else max = Infinite;
+    }
+    if (!accept('}')) return false;
+    if (min > MaxRepeat || (max != Infinite && max > MaxRepeat)) {
+        fail("Repetition count too large");
+    }
+    if (max < min) fail("Invalid repetition count");
+    return true;
+}
+
+uint32_t Regex::Compiler::parseNumber() {
+    uint32_t toReturn = 0;
+    while (more() && peek() >= '0' && peek() <= '9') {
+        uint32_t digit = next() - '0';
+        // anything above MaxRepeat is rejected anyway
+        if (toReturn <= MaxRepeat) toReturn = toReturn * 10 + digit;
+    }
+    return toReturn;
+}
+
+int32_t Regex::Compiler::parseAtom() {
+    CharSet set;
+    uint32_t c = next();
+    switch (c) {
+    case '(': {
+        if (++_depth > MaxNesting) fail("Too many nested groups");
+        int32_t group = -1;
+        if (accept('?')) {
+            if (!accept(':')) fail("Unsupported group");
+        } else {
+            if (_groups == MaxGroups) fail("Too many groups");
+            group = ++_groups;
+        }
+        int32_t body = parseAlternation();
+        if (!accept(')')) fail("Missing )");
+        --_depth;
+        int32_t n = node(Node::Group);
+        _nodes.get(n).child = body;
+        _nodes.get(n).group = group;
+        return n;
+    }
+    case '[':
+        return parseClass();
+    case '.':
+        set.add(0, '\n' - 1);
+        set.add('\n' + 1, MaxCodePoint);
+        return setNode(set);
+    case '^':
+        return node(Node::Begin);
+    case '$':
+        return node(Node::End);
+    case '\\':
+        parseEscape(set);
+        return setNode(set);
+    case '*':
+    case '+':
+    case '?':
+        --_pos;
+        fail("Nothing to repeat");
+        return -1;
+    default:
+        set.add(c, c);
+        return setNode(set);
+    }
+}
+
+int32_t Regex::Compiler::parseClass() {
+    CharSet set;
+    bool negated = accept('^');
+    bool first = true;
+    for (;;) {
+        if (!more()) fail("Missing ]");
+        uint32_t c = next();
+        if (c == ']' && !first) break;
+        first = false;
+
+        uint32_t lo = c;
+        if (c == '\\') {
+            CharSet escaped;
+            parseEscape(escaped);
+            if (escaped.ranges.size() != 1 ||
+                    escaped.ranges.get(0).lo != escaped.ranges.get(0).hi) {
+                // a class like \d, which can't start a range
+                set.add(escaped);
+                continue;
+            }
+            lo = escaped.ranges.get(0).lo;
+        }
+
+        if (_pos + 1 < _length && _text[_pos] == '-' &&
+                _text[_pos + 1] != ']') {
+            ++_pos;
+            uint32_t hi = next();
+            if (hi == '\\') {
+                CharSet escaped;
+                parseEscape(escaped);
+                if (escaped.ranges.size() != 1 ||
+                        escaped.ranges.get(0).lo != escaped.ranges.get(0).hi) {
+                    fail("Invalid range");
+                }
+                hi = escaped.ranges.get(0).lo;
+            }
+            if (hi < lo) fail("Invalid range");
+            set.add(lo, hi);
+        } else {
+            set.add(lo, lo);
+        }
+    }
+    set.normalize();
+    if (negated) set.negate();
+    return setNode(set);
+}
+
+void Regex::Compiler::parseEscape(CharSet& set) {
+    // Expects to be right after the backslash.
+    if (!more()) fail("Trailing backslash");
+    uint32_t c = next();
+    CharSet sub;
+    switch (c) {
+    case 'd':
+    case 'D':
+        sub.add('0', '9');
+        break;
+    case 'w':
+    case 'W':
+        sub.add('0', '9');
+        sub.add('A', 'Z');
+        sub.add('_', '_');
+        sub.add('a', 'z');
+        break;
+    case 's':
+    case 'S':
+        sub.add('\t', '\r');
+        sub.add(' ', ' ');
+        break;
+    case 't':
+        set.add('\t', '\t');
+        return;
+    case 'n':
+        set.add('\n', '\n');
+        return;
+    case 'r':
+        set.add('\r', '\r');
+        return;
+    case 'f':
+        set.add('\f', '\f');
+        return;
+    case 'v':
+        set.add('\v', '\v');
+        return;
+    case '0':
+        set.add(0, 0);
+        return;
+    case 'x':
+        c = parseHex(2);
+        set.add(c, c);
+        return;
+    case 'u':
+        c = parseHex(4);
+        set.add(c, c);
+        return;
+    default:
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+                (c >= 'a' && c <= 'z')) {
+            fail("Unknown escape");
+        }
+        set.add(c, c);
+        return;
+    }
+    // \D, \W and \S
+    if (c < 'a') {
+        sub.normalize();
+        sub.negate();
+    }
+    set.add(sub);
+}
+
+uint32_t Regex::Compiler::parseHex(size_t digits) {
+    uint32_t toReturn = 0;
+    for (size_t i = 0; i < digits; ++i) {
+        if (!more()) fail("Invalid hexadecimal escape");
+        uint32_t c = next();
+        uint32_t digit = 0;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else fail("Invalid hexadecimal escape");
+        toReturn = (toReturn << 4) | digit;
+    }
+    return toReturn;
+}
+
+uint32_t Regex::Compiler::emit(Opcode op, uint32_t x, uint32_t y) {
+    if (_program.size() >= MaxInstructions) {
+        fail("Regular expression too large");
+    }
+    Inst inst = { op, x, y };
+    _program.add(inst);
+    return _program.size() - 1;
+}
+
+void Regex::Compiler::compile(int32_t n) {
+    // A copy, so it doesn't matter if _nodes grows.
+    const Node node = _nodes.get(n);
+    switch (node.kind) {
+    case Node::Empty:
+        break;
+    case Node::Set:
+        emit(OpClass, node.first, node.count);
+        break;
+    case Node::Begin:
+        emit(OpBegin);
+        break;
+    case Node::End:
+        emit(OpEnd);
+        break;
+    case Node::Concat:
+        for (int32_t c = node.child; c != -1; c = _nodes.get(c).next) {
+            compile(c);
+        }
+        break;
+    case Node::Alternate: {
+        Vector<uint32_t> jumps;
+        for (int32_t c = node.child; c != -1; c = _nodes.get(c).next) {
+            if (_nodes.get(c).next == -1) {
+                compile(c);
+                break;
+            }
+            uint32_t split = emit(OpSplit, pc() + 1);
+            compile(c);
+            jumps.add(emit(OpJump));
+            _program.get(split).y = pc();
+        }
+        for (idx_t i = 0; i < jumps.size(); ++i) {
+            _program.get(jumps.get(i)).x = pc();
+        }
+        break;
+    }
+    case Node::Group:
+        if (node.group >= 0) emit(OpSave, 2 * node.group);
+        compile(node.child);
+        if (node.group >= 0) emit(OpSave, 2 * node.group + 1);
+        break;
+    case Node::Repeat:
+        if (node.max == Infinite) {
+            // x{n,} is n - 1 times x, followed by x+
+            for (uint32_t i = 1; i < node.min; ++i) compile(node.child);
+            if (node.min > 0) {
+                uint32_t loop = pc();
+                compile(node.child);
+                uint32_t split = emit(OpSplit, loop, pc() + 1);
+                if (!node.greedy) {
+                    std::swap(_program.get(split).x, _program.get(split).y);
+                }
+            } else {
+                uint32_t split = emit(OpSplit, pc() + 1);
+                compile(node.child);
+                emit(OpJump, split);
+                _program.get(split).y = pc();
+                if (!node.greedy) {
+                    std::swap(_program.get(split).x, _program.get(split).y);
+                }
+            }
+        } else {
+            // x{n,m} is n times x, followed by m - n nested optional x
+            for (uint32_t i = 0; i < node.min; ++i) compile(node.child);
+            Vector<uint32_t> splits;
+            for (uint32_t i = node.min; i < node.max; ++i) {
+                splits.add(emit(OpSplit, pc() + 1));
+                compile(node.child);
+            }
+            for (idx_t i = 0; i < splits.size(); ++i) {
+                Inst& split = _program.get(splits.get(i));
+                split.y = pc();
+                if (!node.greedy) std::swap(split.x, split.y);
+            }
+        }
+        break;
+    }
+}
+
+void Regex::Compiler::compile() {
+    int32_t root = parseAlternation();
+    if (more()) fail("Unmatched )");
+
+    emit(OpSave, 0);
+    compile(root);
+    emit(OpSave, 1);
+    emit(OpMatch);
+
+    size_t threads = 0;
+    for (size_t pc = 0; pc < _program.size(); ++pc) {
+        Opcode op = _program.get(pc).op;
+        if (op == OpClass || op == OpMatch) ++threads;
+    }
+    if (threads * 2 * (_groups + 1) > MaxCaptureSlots) {
+        fail("Too many groups for the size of the regular expression");
+    }
+
+    _data.groups = _groups;
+    _data.threads = threads;
+    _data.program = _program.toArray();
+    _data.ranges = _ranges.toArray();
+    _data.prepare();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void Regex::Data::prepare() {
+    size_t size = program.length;
+    ascii = Array<uint32_t>(4 * size);
+    Vector<uint32_t> edges;
+    edges.add(0);
+    for (idx_t pc = 0; pc < size; ++pc) {
+        const Inst& inst = program[pc];
+        if (inst.op != OpClass) continue;
+        for (uint32_t r = inst.x; r < inst.x + inst.y; ++r) {
+            uint32_t lo = ranges[2 * r];
+            uint32_t hi = ranges[2 * r + 1];
+            edges.add(lo);
+            if (hi < MaxCodePoint) edges.add(hi + 1);
+            for (uint32_t c = lo; c <= hi && c < 128; ++c) {
+                ascii[4 * pc + (c >> 5)] |= uint32_t(1) << (c & 31);
+            }
+        }
+    }
+
+    Array<uint32_t> sorted = edges.toArray();
+    std::sort(sorted.carray(), sorted.carray() + sorted.length);
+    size_t classes = std::unique(sorted.carray(), sorted.carray() +
+            sorted.length) - sorted.carray();
+    bounds = Array<uint32_t>(classes);
+    carraycopy(sorted.carray(), 0, bounds.carray(), 0, classes);
+    asciiClass = Array<uint32_t>((size_t)128);
+    for (uint32_t c = 0; c < 128; ++c) {
+        asciiClass[c] = std::upper_bound(bounds.carray(), bounds.carray() +
+                classes, c) - bounds.carray() - 1;
+    }
+
+    mark = Array<uint32_t>(size);
+    stack = Array<uint32_t>(size + 1);
+    set = Array<uint32_t>(size);
+    setSize = 0;
+
+    newSet();
+    follow(0, false, false);
+    canSkip = true;
+    firstOther = false;
+    firstAscii[0] = firstAscii[1] = firstAscii[2] = firstAscii[3] = 0;
+    for (idx_t i = 0; i < setSize; ++i) {
+        uint32_t pc = set[i];
+        if (program[pc].op != OpClass) {
+            canSkip = false;
+            break;
+        }
+        for (idx_t w = 0; w < 4; ++w) firstAscii[w] |= ascii[4 * pc + w];
+        uint32_t last = program[pc].x + program[pc].y - 1;
+        if (program[pc].y != 0 && ranges[2 * last + 1] >= 128) {
+            firstOther = true;
+        }
+    }
+    // A Begin is dropped by follow(), so check it isn't there at all.
+    for (idx_t pc = 0; pc < size; ++pc) {
+        if (program[pc].op == OpBegin) canSkip = false;
+    }
+}
+
+inline bool Regex::Data::canStart(uint32_t cp) const {
+    if (cp < 128) return (firstAscii[cp >> 5] >> (cp & 31)) & 1;
+    return firstOther;
+}
+
+inline bool Regex::Data::inClass(uint32_t pc, uint32_t cp) const {
+    if (cp < 128) {
+        return (ascii.carray()[4 * pc + (cp >> 5)] >> (cp & 31)) & 1;
+    }
+    const Inst& inst = program.carray()[pc];
+    const uint32_t * r = ranges.carray() + 2 * inst.x;
+    size_t lo = 0;
+    size_t hi = inst.y;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (cp < r[2 * mid]) hi = mid;
+        else if (cp > r[2 * mid + 1]) lo = mid + 1;
+        else return true;
+    }
+    return false;
+}
+
+inline uint32_t Regex::Data::classOf(uint32_t cp) const {
+    if (cp < 128) return asciiClass.carray()[cp];
+    return std::upper_bound(bounds.carray(), bounds.carray() + bounds.length,
+            cp) - bounds.carray() - 1;
+}
+
+void Regex::Data::newSet() const {
+    if (++generation == 0) {
+        // wrapped around, so old marks could look current
+        for (idx_t i = 0; i < mark.length; ++i) mark[i] = 0;
+        generation = 1;
+    }
+    setSize = 0;
+}
+
+void Regex::Data::follow(uint32_t start, bool atBegin, bool atEnd) const {
+    const Inst * prog = program.carray();
+    uint32_t * m = mark.carray();
+    uint32_t * st = stack.carray();
+    size_t top = 0;
+    st[top++] = start;
+    while (top > 0) {
+        uint32_t pc = st[--top];
+        while (m[pc] != generation) {
+            m[pc] = generation;
+            const Inst& inst = prog[pc];
+            if (inst.op == OpJump) {
+                pc = inst.x;
+            } else if (inst.op == OpSplit) {
+                st[top++] = inst.y;
+                pc = inst.x;
+            } else if (inst.op == OpSave || (inst.op == OpBegin && atBegin) ||
+                    (inst.op == OpEnd && atEnd)) {
+                ++pc;
+            } else {
+                // OpClass, OpMatch, and OpEnd when not at the end yet are
+                // kept; a failing OpBegin is dropped.
+                if (inst.op != OpBegin) set.carray()[setSize++] = pc;
+                break;
+            }
+        }
+    }
+}
+
+static size_t hashSet(const uint32_t * set, size_t size) {
+    uint64_t h = size;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ set[i]) * UINT64_C(0x100000001B3);
+    }
+    return h ^ (h >> 29);
+}
+
+int32_t Regex::Data::addState(Dfa& dfa) const {
+    uint32_t * s = set.carray();
+    std::sort(s, s + setSize);
+    size_t h = hashSet(s, setSize);
+
+    size_t mask = dfa.table.length - 1;
+    if (dfa.table.length != 0) {
+        for (size_t i = h & mask; dfa.table[i] != -1; i = (i + 1) & mask) {
+            int32_t id = dfa.table[i];
+            uint32_t begin = dfa.setStart[id];
+            if (dfa.setStart[id + 1] - begin == setSize && std::equal(s,
+                    s + setSize, dfa.pool.carray() + begin)) {
+                return id;
+            }
+        }
+    }
+    if (dfa.states >= MaxDfaStates) return -1;
+
+    // a new state
+    int32_t id = dfa.states++;
+    size_t classes = bounds.length;
+    reserve(dfa.setStart, dfa.states + 1, uint32_t(0));
+    if (id == 0) dfa.setStart[0] = 0;
+    uint32_t begin = dfa.setStart[id];
+    reserve(dfa.pool, begin + setSize, uint32_t(0));
+    carraycopy(s, 0, dfa.pool.carray(), begin, setSize);
+    dfa.setStart[id + 1] = begin + setSize;
+    reserve(dfa.next, dfa.states * classes, int32_t(-1));
+    reserve(dfa.hasMatch, dfa.states, byte(0));
+    dfa.hasMatch[id] = 0;
+    for (size_t i = 0; i < setSize; ++i) {
+        if (program[s[i]].op == OpMatch) dfa.hasMatch[id] = 1;
+    }
+
+    // keep the table at most half full
+    if (2 * dfa.states > dfa.table.length) {
+        size_t len = dfa.table.length ? 2 * dfa.table.length : 64;
+        dfa.table = Array<int32_t>(len);
+        for (idx_t i = 0; i < len; ++i) dfa.table[i] = -1;
+        mask = len - 1;
+        for (int32_t other = 0; other < int32_t(dfa.states); ++other) {
+            uint32_t b = dfa.setStart[other];
+            size_t i = hashSet(dfa.pool.carray() + b,
+                    dfa.setStart[other + 1] - b) & mask;
+            while (dfa.table[i] != -1) i = (i + 1) & mask;
+            dfa.table[i] = other;
+        }
+    } else {
+        size_t i = h & mask;
+        while (dfa.table[i] != -1) i = (i + 1) & mask;
+        dfa.table[i] = id;
+    }
+    return id;
+}
+
+int32_t Regex::Data::transition(Dfa& dfa, int32_t s, uint32_t c,
+        bool search) const {
+    uint32_t cp = bounds[c];
+    newSet();
+    for (uint32_t i = dfa.setStart[s]; i < dfa.setStart[s + 1]; ++i) {
+        uint32_t pc = dfa.pool[i];
+        if (program[pc].op == OpClass && inClass(pc, cp)) {
+            follow(pc + 1, false, false);
+        }
+    }
+    // When searching, a match can also start at the next position.
+    if (search) follow(0, false, false);
+    int32_t t = addState(dfa);
+    if (t >= 0) dfa.next[s * bounds.length + c] = t;
+    return t;
+}
+
+bool Regex::Data::acceptsAtEnd(const Dfa& dfa, int32_t s, bool atBegin)
+        const {
+    newSet();
+    for (uint32_t i = dfa.setStart[s]; i < dfa.setStart[s + 1]; ++i) {
+        uint32_t pc = dfa.pool[i];
+        if (program[pc].op == OpMatch) return true;
+        if (program[pc].op == OpEnd) follow(pc + 1, atBegin, true);
+    }
+    for (size_t i = 0; i < setSize; ++i) {
+        if (program[set[i]].op == OpMatch) return true;
+    }
+    return false;
+}
+
+DfaResult Regex::Data::runDfa(Dfa& dfa, const uchar * text, size_t len,
+        size_t from, bool search) const {
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    bool atBegin = from == 0;
+    int32_t s = dfa.start[atBegin];
+    if (s < 0) {
+        newSet();
+        follow(0, atBegin, false);
+        s = addState(dfa);
+        if (s < 0) return DfaGaveUp;
+        dfa.start[atBegin] = s;
+    }
+
+    const size_t classes = bounds.length;
+    // The tables only move when a state is added.
+    const int32_t * next = dfa.next.carray();
+    const byte * hasMatch = dfa.hasMatch.carray();
+    const uint32_t * setStart = dfa.setStart.carray();
+    for (size_t pos = from; pos < len; ) {
+        if (search && hasMatch[s]) return DfaMatch;
+        if (setStart[s] == setStart[s + 1]) return DfaNoMatch;
+        size_t width;
+        uint32_t cp = decodeAt(text, len, pos, width);
+        uint32_t c = classOf(cp);
+        int32_t t = next[s * classes + c];
+        if (t < 0) {
+            t = transition(dfa, s, c, search);
+            if (t < 0) return DfaGaveUp;
+            next = dfa.next.carray();
+            hasMatch = dfa.hasMatch.carray();
+            setStart = dfa.setStart.carray();
+        }
+        s = t;
+        pos += width;
+    }
+    return acceptsAtEnd(dfa, s, len == 0) ? DfaMatch : DfaNoMatch;
+}
+
+// The threads of the NFA simulation at one position, in order of priority.
+// It only points into the scratch memory of runNfa(), so that a search
+// allocates as little as possible.
+struct ThreadList {
+    // The marks are kept between runs, so generation has to continue where
+    // the previous run left off.
+    ThreadList(uint32_t * pcs, uint32_t * mark, sidx_t * caps,
+            uint32_t generation) : pcs(pcs), mark(mark), caps(caps),
+            generation(generation), count(0) {}
+
+    void clear() {
+        ++generation;
+        count = 0;
+    }
+
+    uint32_t * pcs;
+    uint32_t * mark;
+    sidx_t * caps;
+    uint32_t generation;
+    size_t count;
+};
+
+// Adds the thread at pc, with the captures in caps, and all threads
+// reachable from it without consuming anything, to list.
+static void addThread(const Inst * prog, ThreadList& list, uint32_t start,
+        sidx_t * caps, size_t slots, size_t pos, size_t len,
+        NfaFrame * stack) {
+    uint32_t * m = list.mark;
+    size_t top = 0;
+    NfaFrame first = { start, -1, 0 };
+    stack[top++] = first;
+    while (top > 0) {
+        NfaFrame f = stack[--top];
+        if (f.slot >= 0) {
+            caps[f.slot] = f.old;
+            continue;
+        }
+        uint32_t pc = f.pc;
+        while (m[pc] != list.generation) {
+            m[pc] = list.generation;
+            const Inst& inst = prog[pc];
+            if (inst.op == OpJump) {
+                pc = inst.x;
+            } else if (inst.op == OpSplit) {
+                NfaFrame alt = { inst.y, -1, 0 };
+                stack[top++] = alt;
+                pc = inst.x;
+            } else if (inst.op == OpSave) {
+                if (inst.x < slots) {
+                    NfaFrame restore = { 0, int32_t(inst.x), caps[inst.x] };
+                    stack[top++] = restore;
+                    caps[inst.x] = pos;
+                }
+                ++pc;
+            } else if (inst.op == OpBegin) {
+                if (pos != 0) break;
+                ++pc;
+            } else if (inst.op == OpEnd) {
+                if (pos != len) break;
+                ++pc;
+            } else {
+                list.pcs[list.count] = pc;
+                carraycopy(caps, 0, list.caps, list.count * slots, slots);
+                ++list.count;
+                break;
+            }
+        }
+    }
+}
+
+bool Regex::Data::runNfa(const uchar * text, size_t len, size_t from,
+        bool search, sidx_t * slots) const {
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    const Inst * prog = program.carray();
+    const size_t size = program.length;
+    const size_t nslots = 2 * (groups + 1);
+    if (nfaInts.length == 0) {
+        nfaInts = Array<uint32_t>(2 * threads + 2 * size);
+        nfaCaps = Array<sidx_t>((2 * threads + 1) * nslots);
+        nfaStack = Array<NfaFrame>(2 * size + 1);
+    }
+    if (nfaGeneration > uint32_t(-1) / 2) {
+        // start over before the generations wrap around
+        uint32_t * marks = nfaInts.carray() + 2 * threads;
+        for (size_t i = 0; i < 2 * size; ++i) marks[i] = 0;
+        nfaGeneration = 0;
+    }
+    uint32_t * ints = nfaInts.carray();
+    sidx_t * allCaps = nfaCaps.carray();
+    NfaFrame * stack = nfaStack.carray();
+    // Both lists count generations from the same number, but each has its
+    // own marks.
+    ThreadList a(ints, ints + 2 * threads, allCaps, nfaGeneration);
+    ThreadList b(ints + threads, ints + 2 * threads + size,
+            allCaps + threads * nslots, nfaGeneration);
+    a.clear();
+    b.clear();
+    ThreadList * clist = &a;
+    ThreadList * nlist = &b;
+    // the captures of the thread that is being added
+    sidx_t * caps = allCaps + 2 * threads * nslots;
+    bool matched = false;
+    // A full match has to end at the end of the text.
+    bool full = !search;
+
+    for (size_t pos = from; ; ) {
+        if (search && canSkip && !matched && clist->count == 0) {
+            // Nothing is running, so go straight to where a match can start.
+            while (pos < len && !canStart(text[pos])) ++pos;
+            if (pos == len) break;
+        }
+        if (!matched && (search || pos == from) && (!canSkip ||
+                (pos < len && canStart(text[pos])))) {
+            for (size_t i = 0; i < nslots; ++i) caps[i] = -1;
+            addThread(prog, *clist, 0, caps, nslots, pos, len, stack);
+        }
+        if (clist->count == 0) break;
+
+        size_t width = 0;
+        uint32_t cp = pos < len ? decodeAt(text, len, pos, width) : 0;
+        nlist->clear();
+        for (size_t i = 0; i < clist->count; ++i) {
+            uint32_t pc = clist->pcs[i];
+            const sidx_t * tcaps = clist->caps + i * nslots;
+            if (prog[pc].op == OpMatch) {
+                if (full && pos != len) continue;
+                matched = true;
+                carraycopy(tcaps, 0, slots, 0, nslots);
+                // threads of lower priority can't win anymore
+                break;
+            }
+            if (pos < len && inClass(pc, cp)) {
+                carraycopy(tcaps, 0, caps, 0, nslots);
+                addThread(prog, *nlist, pc + 1, caps, nslots,
+                        pos + width, len, stack);
+            }
+        }
+        if (pos >= len) break;
+        std::swap(clist, nlist);
+        pos += width;
+    }
+    nfaGeneration = a.generation > b.generation ? a.generation : b.generation;
+    return matched;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+Regex::Regex(const String pattern) throw(ParseException) :
+        data(new Data(pattern)) {
+    try {
+        Compiler(pattern, *data).compile();
+    } catch (...) {
+        delete data;
+        throw;
+    }
+}
+
+Regex::Regex(const Regex& other) : data(other.data) {
+    data->refcount.acquire();
+}
+
+Regex::~Regex() {
+    if (data->refcount.release()) delete data;
+}
+
+Regex& Regex::operator=(const Regex& other) {
+    if (data == other.data) return *this;
+    other.data->refcount.acquire();
+    if (data->refcount.release()) delete data;
+    data = other.data;
+    return *this;
+}
+
+String Regex::pattern() const {
+    return data->pattern;
+}
+
+size_t Regex::groupCount() const {
+    return data->groups;
+}
+
+bool Regex::matches(const StringView text) const {
+    DfaResult r = data->runDfa(data->anchored, text.data(), text.length(), 0,
+            false);
+    if (r != DfaGaveUp) return r == DfaMatch;
+    return match(text).matched();
+}
+
+bool Regex::foundIn(const StringView text) const {
+    DfaResult r = data->runDfa(data->unanchored, text.data(), text.length(),
+            0, true);
+    if (r != DfaGaveUp) return r == DfaMatch;
+    return find(text).matched();
+}
+
+Regex::Match Regex::match(const StringView text) const {
+    Match toReturn;
+    DfaResult r = data->runDfa(data->anchored, text.data(), text.length(), 0,
+            false);
+    if (r == DfaNoMatch) return toReturn;
+
+    Array<sidx_t> offsets(2 * (data->groups + 1));
+    if (data->runNfa(text.data(), text.length(), 0, false,
+            offsets.carray())) {
+        toReturn._text = text;
+        toReturn._offsets = offsets;
+    }
+    return toReturn;
+}
+
+Regex::Match Regex::find(const StringView text, idx_t from) const
+        throw(ArrayException) {
+    if (from > text.length()) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "Regex search from %u, length: %u",
+                unsigned(from), unsigned(text.length()));
+        sthrow(ArrayException, buf);
+    }
+    Match toReturn;
+    // Most texts that are searched don't match, and the DFA finds that out
+    // much faster than the NFA.
+    DfaResult r = data->runDfa(data->unanchored, text.data(), text.length(),
+            from, true);
+    if (r == DfaNoMatch) return toReturn;
+
+    Array<sidx_t> offsets(2 * (data->groups + 1));
+    if (data->runNfa(text.data(), text.length(), from, true,
+            offsets.carray())) {
+        toReturn._text = text;
+        toReturn._offsets = offsets;
+    }
+    return toReturn;
+}
+
+Array<Regex::Match> Regex::findAll(const StringView text) const {
+    Vector<Match> matches;
+    size_t from = 0;
+    while (from <= text.length()) {
+        Match m = find(text, from);
+        if (!m.matched()) break;
+        matches.add(m);
+        size_t end = m.end();
+        if (end == size_t(m.start())) {
+            // step over the character after an empty match
+            if (end == text.length()) break;
+            size_t width;
+            decodeAt(text.data(), text.length(), end, width);
+            end += width;
+        }
+        from = end;
+    }
+    return matches.toArray();
+}
+
+StringView Regex::view(const StringView text, sidx_t start, sidx_t end) {
+    if (start < 0) return StringView();
+    return StringView(text._str, text._offset + start, end - start);
+}
+
+// Match doesn't leave this to Array, which doesn't check its indices when
+// built with SYLPH_UNCHECKED_ARRAYS.
+static void checkGroup(idx_t group, size_t offsets) throw(ArrayException) {
+    if (2 * group < offsets) return;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "No group %u in match with %u groups",
+            unsigned(group), unsigned(offsets / 2));
+    sthrow(ArrayException, buf);
+}
+
+sidx_t Regex::Match::start(idx_t group) const throw(ArrayException) {
+    checkGroup(group, _offsets.length);
+    return _offsets.unsafeAt(2 * group);
+}
+
+sidx_t Regex::Match::end(idx_t group) const throw(ArrayException) {
+    checkGroup(group, _offsets.length);
+    return _offsets.unsafeAt(2 * group + 1);
+}
+
+StringView Regex::Match::group(idx_t group) const throw(ArrayException) {
+    return view(_text, start(group), end(group));
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
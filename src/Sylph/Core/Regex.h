@@ -0,0 +1,237 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_REGEX_H_
+#define SYLPH_CORE_REGEX_H_
+
+#include "Object.h"
+#include "Array.h"
+#include "Exception.h"
+#include "Primitives.h"
+#include "String.h"
+#include "StringView.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A compiled regular expression. A Regex is compiled once, and can then be
+ * matched against any number of Strings or StringViews. Matching works on
+ * the UTF-16 data directly, nothing is converted to UTF-8, and takes time
+ * linear in the length of the text: there is no backtracking, so no pattern
+ * can make matching take exponential time.<p>
+ * The supported syntax is:
+ * <ul>
+ * <li>Literal characters, and <code>\\</code> followed by any punctuation
+ * character to match that character literally.</li>
+ * <li><code>.</code>, any character except a newline.</li>
+ * <li>Character classes such as <code>[abc]</code>, <code>[a-z0-9]</code>
+ * and <code>[^"]</code>.</li>
+ * <li><code>\\d</code>, <code>\\w</code>, <code>\\s</code> and their
+ * negations <code>\\D</code>, <code>\\W</code>, <code>\\S</code>, also
+ * inside character classes. These only match ASCII characters.</li>
+ * <li><code>\\t</code>, <code>\\n</code>, <code>\\r</code>, <code>\\f</code>,
+ * <code>\\v</code>, <code>\\0</code>, <code>\\xHH</code> and
+ * <code>\\uHHHH</code>.</li>
+ * <li><code>^</code> and <code>$</code>, the start and the end of the text.
+ * </li>
+ * <li>Alternation with <code>|</code>, capturing groups <code>(...)</code>
+ * and non-capturing groups <code>(?:...)</code>.</li>
+ * <li>The quantifiers <code>*</code>, <code>+</code>, <code>?</code>,
+ * <code>{n}</code>, <code>{n,}</code> and <code>{n,m}</code>, all of which
+ * can be made lazy by appending a <code>?</code>.</li>
+ * </ul>
+ * Characters are matched as code points, so <code>.</code> matches a
+ * surrogate pair as a whole. All offsets are counted in UTF-16 units,
+ * like everywhere else in String.<p>
+ * When several matches start at the same position, the one that is found is
+ * the one Perl would find: alternatives are tried from left to right, greedy
+ * quantifiers prefer more repetitions, and lazy ones fewer.<p>
+ * Whether a text matches at all is decided by a DFA that is built lazily,
+ * while matching, and kept with the Regex. Only when the capture groups are
+ * needed, the pattern is simulated as an NFA. Copies of a Regex share the
+ * compiled pattern and the DFA. If LibSylph is built with
+ * @c SYLPH_ATOMIC_REFCOUNT, a Regex can be used from multiple threads at the
+ * same time; otherwise it cannot.<p>
+ * An example:
+ * <pre>Regex re("(\\\\w+)=(\\\\d+)");
+ * String line = "width=80";
+ * Regex::Match m = re.find(line);
+ * if (m.matched()) {
+ *     String key = m.group(1);
+ * }</pre>
+ */
+class Regex : public virtual Object {
+public:
+    /**
+     * The result of matching a Regex against a text. A Match keeps the text
+     * alive, and tells where the whole match and every capture group were
+     * found in it.
+     */
+    class Match {
+        friend class Regex;
+    public:
+        /**
+         * Creates a Match that did not match anything.
+         */
+        Match() {}
+
+        /**
+         * Checks whether the Regex matched.
+         * @return @em true if the Regex matched, @em false otherwise.
+         */
+        bool matched() const {
+            return _offsets.length != 0;
+        }
+
+        /**
+         * Returns the amount of capture groups in the Regex, not counting
+         * the whole match, or 0 if there was no match.
+         */
+        size_t groupCount() const {
+            return _offsets.length == 0 ? 0 : _offsets.length / 2 - 1;
+        }
+
+        /**
+         * Returns where a group starts in the text.
+         * @param group The group, 0 for the whole match.
+         * @return The index of the first character of the group, or -1 if
+         * the group did not take part in the match.
+         * @throw ArrayException If there is no such group.
+         */
+        sidx_t start(idx_t group = 0) const throw(ArrayException);
+
+        /**
+         * Returns where a group ends in the text.
+         * @param group The group, 0 for the whole match.
+         * @return The index right after the last character of the group, or
+         * -1 if the group did not take part in the match.
+         * @throw ArrayException If there is no such group.
+         */
+        sidx_t end(idx_t group = 0) const throw(ArrayException);
+
+        /**
+         * Returns the text matched by a group.
+         * @param group The group, 0 for the whole match.
+         * @return A view on the text matched by the group, which is empty if
+         * the group did not take part in the match.
+         * @throw ArrayException If there is no such group.
+         */
+        StringView group(idx_t group = 0) const throw(ArrayException);
+
+    private:
+        StringView _text;
+        // start and end of every group, group 0 first
+        Array<sidx_t> _offsets;
+    };
+
+    /**
+     * Compiles a regular expression.
+     * @param pattern The regular expression, in the syntax described above.
+     * @throw ParseException If the pattern is not a valid regular expression.
+     */
+    explicit Regex(const String pattern) throw(ParseException);
+
+    /**
+     * Creates a Regex sharing the compiled pattern of another one.
+     */
+    Regex(const Regex& other);
+
+    /**
+     * Destructor.
+     */
+    virtual ~Regex();
+
+    /**
+     * Makes this Regex share the compiled pattern of another one.
+     */
+    Regex& operator=(const Regex& other);
+
+    /**
+     * Returns the pattern this Regex was compiled from.
+     */
+    String pattern() const;
+
+    /**
+     * Returns the amount of capture groups in the pattern, not counting the
+     * whole match.
+     */
+    size_t groupCount() const;
+
+    /**
+     * Checks whether the entire text matches. This never needs to look at
+     * the capture groups, and is the fastest way to validate input.
+     * @param text The text to match.
+     * @return @em true if the whole text matches, @em false otherwise.
+     */
+    bool matches(const StringView text) const;
+
+    /**
+     * Checks whether the Regex matches anywhere in the text. Like matches(),
+     * this never needs to look at the capture groups.
+     * @param text The text to search in.
+     * @return @em true if the Regex matches somewhere in the text.
+     */
+    bool foundIn(const StringView text) const;
+
+    /**
+     * Matches the entire text, and returns the capture groups.
+     * @param text The text to match.
+     * @return The match, which did not match if the whole text doesn't.
+     */
+    Match match(const StringView text) const;
+
+    /**
+     * Finds the first match in the text, starting at a given position.
+     * <code>^</code> still only matches at the start of the text.
+     * @param text The text to search in.
+     * @param from The index in the text to start searching from.
+     * @return The first match, which did not match if there is none.
+     * @throw ArrayException If @c from is beyond the end of the text.
+     */
+    Match find(const StringView text, idx_t from = 0) const
+            throw(ArrayException);
+
+    /**
+     * Finds all matches in the text that do not overlap, from left to right.
+     * After an empty match, the search continues one character further.
+     * @param text The text to search in.
+     * @return All matches, in order.
+     */
+    Array<Match> findAll(const StringView text) const;
+
+private:
+    struct Data;
+    class Compiler;
+
+    static StringView view(const StringView text, sidx_t start, sidx_t end);
+
+    Data * data;
+};
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_REGEX_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
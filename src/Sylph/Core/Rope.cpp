@@ -0,0 +1,309 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+#include "Rope.h"
+#include "Util.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+// A Rope is an AVL tree: the heights of the children of every node differ
+// by at most one, which keeps the depth below 1.44 log2(n). Nodes are
+// immutable and reference counted, so that Ropes can share them. All the
+// static helpers below take borrowed references and return new ones.
+struct Rope::Node {
+    explicit Node(const StringView& s) : left(null), right(null), leaf(s),
+            length(s.length()), height(0) {
+    }
+
+    Node(Node* l, Node* r) : left(l), right(r), length(l->length + r->length),
+            height(1 + (l->height > r->height ? l->height : r->height)) {
+        l->refcount.acquire();
+        r->refcount.acquire();
+    }
+
+    ~Node() {
+        release(left);
+        release(right);
+    }
+
+    bool isLeaf() const {
+        return !left;
+    }
+
+    static int heightOf(const Node* n) {
+        return n ? n->height : -1;
+    }
+
+    // Whether the two nodes are leaves short enough to be merged.
+    static bool mergeable(const Node* l, const Node* r) {
+        return l && r && l->isLeaf() && r->isLeaf() &&
+                l->length + r->length <= MergeLength;
+    }
+
+    RefCount refcount;
+    Node* left;
+    Node* right;
+    StringView leaf;
+    size_t length;
+    int height;
+};
+
+const size_t Rope::MergeLength;
+
+Rope::Rope() : _root(null) {
+}
+
+Rope::Rope(const String s) : _root(leaf(s)) {
+}
+
+Rope::Rope(const char* s) : _root(leaf(String(s))) {
+}
+
+Rope::Rope(const StringView s) : _root(leaf(s)) {
+}
+
+Rope::Rope(const Rope& other) : _root(other._root) {
+    if (_root) _root->refcount.acquire();
+}
+
+Rope::Rope(Node* root) : _root(root) {
+}
+
+Rope::~Rope() {
+    release(_root);
+}
+
+Rope& Rope::operator=(const Rope& other) {
+    if (other._root) other._root->refcount.acquire();
+    release(_root);
+    _root = other._root;
+    return *this;
+}
+
+Rope& Rope::operator+=(const Rope other) {
+    Node* joined = concat(_root, other._root);
+    release(_root);
+    _root = joined;
+    return *this;
+}
+
+size_t Rope::length() const {
+    return _root ? _root->length : 0;
+}
+
+uchar Rope::at(sidx_t idx) const {
+    size_t len = length();
+#if SYLPH_CHECKED_ARRAYS
+    // a negative index wraps around to a huge one
+    if (size_t(idx) >= len && (idx >= 0 || size_t(-idx) > len)) {
+        throwArrayOverflow(idx, len, "Rope");
+    }
+#endif
+
+    size_t i = idx >= 0 ? idx : len + idx;
+    const Node * n = _root;
+    while (!n->isLeaf()) {
+        if (i < n->left->length) {
+            n = n->left;
+        } else {
+            i -= n->left->length;
+            n = n->right;
+        }
+    }
+    return n->leaf.data()[i];
+}
+
+Rope Rope::slice(idx_t begin) const throw(ArrayException) {
+    return slice(begin, length() - 1);
+}
+
+Rope Rope::slice(idx_t begin, idx_t end) const throw(ArrayException) {
+    if (begin > end) sthrow(ArrayException, "Inverted range");
+    if (end >= length()) throwArrayOverflow(end, length(), "Rope");
+
+    Node * head, * tail, * part, * rest;
+    split(_root, end + 1, head, tail);
+    split(head, begin, rest, part);
+    release(head);
+    release(tail);
+    release(rest);
+    return Rope(part);
+}
+
+Rope Rope::insert(idx_t idx, const Rope other) const throw(ArrayException) {
+    if (idx > length()) throwArrayOverflow(idx, length(), "Rope");
+
+    Node * head, * tail;
+    split(_root, idx, head, tail);
+    Node * front = concat(head, other._root);
+    Node * joined = concat(front, tail);
+    release(head);
+    release(tail);
+    release(front);
+    return Rope(joined);
+}
+
+String Rope::toString() const {
+    if (!_root) return String();
+    // a single leaf needs no copying if it covers a whole String
+    if (_root->isLeaf()) return _root->leaf.toString();
+
+    String toReturn;
+    uchar * dest = toReturn.allocate(_root->length);
+    // The depth of an AVL tree never exceeds 1.44 log2(n), which is less than
+    // 96 for any n that fits in memory.
+    const Node * stack[96];
+    size_t depth = 0;
+    const Node * n = _root;
+    for (;;) {
+        while (!n->isLeaf()) {
+            stack[depth++] = n->right;
+            n = n->left;
+        }
+        carraycopy(n->leaf.data(), 0, dest, 0, n->length);
+        dest += n->length;
+        if (depth == 0) break;
+        n = stack[--depth];
+    }
+    return toReturn;
+}
+
+Rope::Node* Rope::leaf(const StringView& s) {
+    return s.length() ? new Node(s) : null;
+}
+
+Rope::Node* Rope::concat(Node* left, Node* right) {
+    if (!left || !right) {
+        Node * n = left ? left : right;
+        if (n) n->refcount.acquire();
+        return n;
+    }
+
+    if (Node::mergeable(left, right)) {
+        String merged;
+        uchar * dest = merged.allocate(left->length + right->length);
+        carraycopy(left->leaf.data(), 0, dest, 0, left->length);
+        carraycopy(right->leaf.data(), 0, dest, left->length, right->length);
+        return new Node(StringView(merged));
+    }
+
+    // Descend along the spine of the higher tree until the heights match,
+    // or until a short leaf is found that the other side can be merged into.
+    int lh = left->height;
+    int rh = right->height;
+    if (lh > rh + 1 || (!left->isLeaf() && Node::mergeable(left->right,
+            right))) {
+        Node * joined = concat(left->right, right);
+        Node * n = balance(left->left, joined);
+        release(joined);
+        return n;
+    } else if (rh > lh + 1 || (!right->isLeaf() && Node::mergeable(left,
+            right->left))) {
+        Node * joined = concat(left, right->left);
+        Node * n = balance(joined, right->right);
+        release(joined);
+        return n;
+    } else {
+        return new Node(left, right);
+    }
+}
+
+Rope::Node* Rope::balance(Node* left, Node* right) {
+    // The heights of left and right differ by at most two here; a single or
+    // double rotation restores the balance.
+    int lh = Node::heightOf(left);
+    int rh = Node::heightOf(right);
+    Node * inner;
+    Node * outer;
+    if (lh > rh + 1) {
+        if (Node::heightOf(left->left) >= Node::heightOf(left->right)) {
+            inner = new Node(left->right, right);
+            outer = new Node(left->left, inner);
+        } else {
+            Node * pivot = left->right;
+            Node * first = new Node(left->left, pivot->left);
+            inner = new Node(pivot->right, right);
+            outer = new Node(first, inner);
+            release(first);
+        }
+    } else if (rh > lh + 1) {
+        if (Node::heightOf(right->right) >= Node::heightOf(right->left)) {
+            inner = new Node(left, right->left);
+            outer = new Node(inner, right->right);
+        } else {
+            Node * pivot = right->left;
+            inner = new Node(left, pivot->left);
+            Node * second = new Node(pivot->right, right->right);
+            outer = new Node(inner, second);
+            release(second);
+        }
+    } else {
+        return new Node(left, right);
+    }
+    release(inner);
+    return outer;
+}
+
+void Rope::split(Node* node, idx_t idx, Node*& left, Node*& right) {
+    if (!node || idx == 0) {
+        left = null;
+        right = node;
+        if (node) node->refcount.acquire();
+    } else if (idx >= node->length) {
+        left = node;
+        right = null;
+        node->refcount.acquire();
+    } else if (node->isLeaf()) {
+        left = new Node(node->leaf.slice(0, idx - 1));
+        right = new Node(node->leaf.slice(idx));
+    } else if (idx <= node->left->length) {
+        Node * rest;
+        split(node->left, idx, left, rest);
+        right = concat(rest, node->right);
+        release(rest);
+    } else {
+        Node * rest;
+        split(node->right, idx - node->left->length, rest, right);
+        left = concat(node->left, rest);
+        release(rest);
+    }
+}
+
+void Rope::release(Node* node) {
+    if (node && node->refcount.release()) delete node;
+}
+
+Rope operator+(const Rope lhs, const Rope rhs) {
+    Rope toReturn = lhs;
+    toReturn += rhs;
+    return toReturn;
+}
+
+std::ostream& operator<<(std::ostream& out, const Rope& rope) {
+    return out << rope.toString();
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,210 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+#ifndef SYLPH_CORE_ROPE_H_
+#define SYLPH_CORE_ROPE_H_
+
+#include "Object.h"
+#include "Exception.h"
+#include "Primitives.h"
+#include "String.h"
+#include "StringView.h"
+
+#include <ostream>
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A String made up of other Strings, for building or editing large texts.
+ * Where appending to a String copies both sides, a Rope is a balanced tree
+ * whose leaves refer to the Strings it was built from, so concatenating,
+ * inserting and slicing only create O(log n) new nodes and never copy the
+ * characters themselves. Once done, toString() copies everything into a
+ * single String at once.
+ *
+ * Like String, a Rope is immutable: insert() and slice() return new Ropes,
+ * which share all unchanged parts with the original. Only operator+=()
+ * changes the Rope it is called on, by replacing its contents. Copying a
+ * Rope is as cheap as copying a String.
+ *
+ * Leaves shorter than MergeLength are merged as they are concatenated, so
+ * that building a Rope one character at a time does not create a node per
+ * character.
+ * <pre>Rope doc;
+ * for (...) doc += line;
+ * doc = doc.insert(0, header);
+ * String text = doc.toString();</pre>
+ */
+class Rope : public virtual Object {
+public:
+    /**
+     * Leaves that together hold at most this many characters are merged
+     * into one when they are concatenated.
+     */
+    static const size_t MergeLength = 256;
+
+    /**
+     * Creates an empty Rope.
+     */
+    Rope();
+
+    /**
+     * Creates a Rope holding the given String, without copying it.
+     * @param s The initial contents of this Rope.
+     */
+    Rope(const String s);
+
+    /**
+     * Creates a Rope holding the given UTF-8 encoded C-style string.
+     * @param s A null-terminated string.
+     * @see String::String(const char*)
+     */
+    Rope(const char* s);
+
+    /**
+     * Creates a Rope holding the characters of the given view, without
+     * copying them.
+     * @param s The initial contents of this Rope.
+     */
+    Rope(const StringView s);
+
+    /**
+     * Creates a Rope with the same contents as another one. This does not
+     * copy anything but a reference.
+     * @param other The Rope to copy.
+     */
+    Rope(const Rope& other);
+
+    virtual ~Rope();
+
+    /**
+     * Replaces the contents of this Rope by those of another one.
+     * @param other The Rope to copy.
+     * @return A reference to this Rope.
+     */
+    Rope& operator=(const Rope& other);
+
+    /**
+     * Appends another Rope to this one.
+     * @param other The Rope to append.
+     * @return A reference to this Rope.
+     * @complexity O(log n)
+     */
+    Rope& operator+=(const Rope other);
+
+    /**
+     * Returns the amount of UTF-16 units in this Rope.
+     * @return The length of this Rope.
+     * @complexity O(1)
+     */
+    size_t length() const;
+
+    /**
+     * Checks whether this Rope is empty.
+     * @return <i>true</i> iff length() == 0.
+     */
+    bool empty() const {
+        return length() == 0;
+    }
+
+    /**
+     * Returns the character at given index. Negative indices count from the
+     * end, like for String::at().
+     * @param idx The index of the character.
+     * @return The UTF-16 unit at that index.
+     * @throw ArrayException if the index is out of range, unless the library
+     * was built with @c SYLPH_UNCHECKED_ARRAYS
+     * @complexity O(log n)
+     */
+    uchar at(sidx_t idx) const;
+
+    /**
+     * Returns the part of this Rope from the given index to the end.
+     * @param begin The first index of the part.
+     * @return A Rope sharing its leaves with this one.
+     * @throw ArrayException if <code>begin >= length()</code>.
+     * @complexity O(log n)
+     */
+    Rope slice(idx_t begin) const throw(ArrayException);
+
+    /**
+     * Returns the part of this Rope from the given begin index up to and
+     * including the given end index, like String::slice().
+     * @param begin The first index of the part.
+     * @param end The last index of the part.
+     * @return A Rope sharing its leaves with this one.
+     * @throw ArrayException if <code>begin >= length() || end >= length() ||
+     * begin > end</code>.
+     * @complexity O(log n)
+     */
+    Rope slice(idx_t begin, idx_t end) const throw(ArrayException);
+
+    /**
+     * Returns a Rope with another Rope inserted at given index.
+     * @param idx The index the first inserted character will have. Equal to
+     * length() to append.
+     * @param other The Rope to insert.
+     * @return A new Rope; this Rope remains unchanged.
+     * @throw ArrayException if <code>idx > length()</code>.
+     * @complexity O(log n)
+     */
+    Rope insert(idx_t idx, const Rope other) const throw(ArrayException);
+
+    /**
+     * Copies all characters of this Rope into a single String.
+     * @return A String with the contents of this Rope.
+     * @complexity O(n)
+     */
+    String toString() const;
+
+private:
+    struct Node;
+
+    explicit Rope(Node* root);
+    static Node* leaf(const StringView& s);
+    static Node* concat(Node* left, Node* right);
+    static Node* balance(Node* left, Node* right);
+    static void split(Node* node, idx_t idx, Node*& left, Node*& right);
+    static void release(Node* node);
+
+    // null if empty
+    Node* _root;
+};
+
+/**
+ * Concatenates two Ropes.
+ * @complexity O(log n)
+ */
+Rope operator+(const Rope lhs, const Rope rhs);
+
+/**
+ * Writes the contents of a Rope to a stream, encoded in UTF-8.
+ */
+std::ostream& operator<<(std::ostream& out, const Rope& rope);
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_ROPE_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
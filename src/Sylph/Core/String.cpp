@@ -26,7 +26,12 @@
 #include "String.h"
 #include "Array.h"
 #include "Hash.h"
+#include "NumberFormat.h"
 #include "StringBuffer.h"
+#include "StringPool.h"
+#include "StringSearcher.h"
+#include "StringTokenizer.h"
+#include "StringView.h"
 #include "Util.h"
 #include "Vector.h"
 
@@ -35,42 +40,384 @@
 #include <cmath>
 
 #include <unicode/uchar.h>
+#include <unicode/unorm2.h>
 #include <unicode/ustring.h>
 #include <gc/gc.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 SYLPH_BEGIN_NAMESPACE
 
-bool startsWithHelper(idx_t from, const String& left, const String& right) {
-    if (left.length() - from < right.length()) return false;
-    uint32_t count = 0;
-    for (idx_t i = 0; i < right.length(); i++) {
-        if (left.at(i + from) == right.at(i)) {
-            count++;
-            if(count == right.length()) return true;
+// Transcoding ////////////////////////////////////////////////////////
+//
+// All loops below first take a fast path over runs of ASCII, which is the
+// common case. With SSE2 (always available on x86-64) these runs are handled
+// 16 bytes or 8 UTF-16 units at a time, the scalar code handles the rest.
+
+static inline bool isHighSurrogate(uchar c) {
+    return (c & 0xFC00) == 0xD800;
+}
+
+static inline bool isLowSurrogate(uchar c) {
+    return (c & 0xFC00) == 0xDC00;
+}
+
+static inline uint32_t combineSurrogates(uchar high, uchar low) {
+    return 0x10000 + (((high & 0x3FF) << 10) | (low & 0x3FF));
+}
+
+// Returns the amount of leading bytes in src that are ASCII.
+static size_t asciiPrefix(const char * src, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        int mask = _mm_movemask_epi8(v);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    while (i < len && !(src[i] & 0x80)) ++i;
+    return i;
+}
+
+// Returns the amount of leading units in src that are ASCII.
+static size_t asciiPrefix(const uchar * src, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i high = _mm_set1_epi16(short(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, high),
+                zero));
+        if (mask != 0xFFFF) return i + (__builtin_ctz(~mask) >> 1);
+    }
+#endif
+    while (i < len && src[i] <= 0x7F) ++i;
+    return i;
+}
+
+// Zero-extends len bytes from src into dest.
+static void widen(const char * src, size_t len, uchar * dest) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 8),
+                _mm_unpackhi_epi8(v, zero));
+    }
+#endif
+    for (; i < len; ++i) dest[i] = static_cast<unsigned char>(src[i]);
+}
+
+// Narrows len units from src into dest, replacing non-ASCII units by '?'.
+static void narrow(const uchar * src, size_t len, char * dest) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i high = _mm_set1_epi16(short(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i question = _mm_set1_epi8('?');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i v2 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(src + i + 8));
+        __m128i ok = _mm_packs_epi16(
+                _mm_cmpeq_epi16(_mm_and_si128(v1, high), zero),
+                _mm_cmpeq_epi16(_mm_and_si128(v2, high), zero));
+        __m128i packed = _mm_packus_epi16(v1, v2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                _mm_or_si128(_mm_and_si128(ok, packed),
+                    _mm_andnot_si128(ok, question)));
+    }
+#endif
+    for (; i < len; ++i) dest[i] = src[i] > 0x7F ? '?' : char(src[i]);
+}
+
+// Copies len units from src into dest, flipping the case of ASCII letters
+// between first and first + 25 ('A' to lower case, 'a' to upper case).
+static void asciiCase(const uchar * src, size_t len, uchar * dest,
+        uchar first) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // Units from 0x8000 up compare as negative, and are never in range.
+    const __m128i below = _mm_set1_epi16(short(first - 1));
+    const __m128i above = _mm_set1_epi16(short(first + 26));
+    const __m128i flip = _mm_set1_epi16(0x20);
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i in = _mm_and_si128(_mm_cmpgt_epi16(v, below),
+                _mm_cmplt_epi16(v, above));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                _mm_xor_si128(v, _mm_and_si128(in, flip)));
+    }
+#endif
+    for (; i < len; ++i) {
+        dest[i] = uchar(src[i] - first) < 26 ? src[i] ^ 0x20 : src[i];
+    }
+}
+
+typedef int32_t (*CaseMapping)(UChar*, int32_t, const UChar*, int32_t,
+        const char*, UErrorCode*);
+
+// Maps len units from src with ICU into small if they fit, or into a new
+// buffer otherwise. Returns the buffer used, and updates len.
+static uchar * icuCase(CaseMapping mapping, const uchar * src, size_t& len,
+        uchar * small, size_t smallCapacity) {
+    UErrorCode error = U_ZERO_ERROR;
+    uchar * buf = small;
+    int32_t newlength = mapping((UChar*)buf, smallCapacity,
+            (const UChar*)src, len, 0, &error);
+    if (error == U_BUFFER_OVERFLOW_ERROR) {
+        buf = new uchar[newlength];
+        error = U_ZERO_ERROR;
+        newlength = mapping((UChar*)buf, newlength, (const UChar*)src, len, 0,
+                &error);
+    }
+    if (U_FAILURE(error)) {
+        if (buf != small) delete[] buf;
+        sthrow(Exception, u_errorName(error));
+    }
+    len = newlength;
+    return buf;
+}
+
+// Returns the amount of bytes needed to encode src as UTF-8.
+static size_t utf8Length(const uchar * src, size_t len) {
+    size_t buflen = len;
+    for (idx_t i = asciiPrefix(src, len); i < len; i++) {
+        if (src[i] <= 0x7F) continue;
+        if (isHighSurrogate(src[i]) && i + 1 < len &&
+                isLowSurrogate(src[i + 1])) {
+            // two units, four bytes
+            buflen += 2;
+            i++;
+        } else {
+            buflen += src[i] > 0x07FF ? 2 : 1;
+        }
+    }
+    return buflen;
+}
+
+// Writes src as UTF-8 into out, and returns the end of what was written.
+static char * writeUtf8(const uchar * src, size_t len, char * out) {
+    idx_t i = 0;
+    while (i < len) {
+        size_t run = asciiPrefix(src + i, len - i);
+        narrow(src + i, run, out);
+        out += run;
+        i += run;
+
+        for (; i < len && src[i] > 0x7F; i++) {
+            uchar c = src[i];
+            if (c <= 0x07FF) {
+                // 2-byte
+                *out++ = 0xC0 | ((c & 0x07C0) >> 6);
+                *out++ = 0x80 | (c & 0x3F);
+            } else if (isHighSurrogate(c) && i + 1 < len &&
+                    isLowSurrogate(src[i + 1])) {
+                // 4-byte, from a surrogate pair
+                uint32_t cp = combineSurrogates(c, src[++i]);
+                *out++ = 0xF0 | (cp >> 18);
+                *out++ = 0x80 | ((cp >> 12) & 0x3F);
+                *out++ = 0x80 | ((cp >> 6) & 0x3F);
+                *out++ = 0x80 | (cp & 0x3F);
+            } else {
+                // 3-byte, lone surrogates are encoded as they are
+                *out++ = 0xE0 | ((c & 0xF000) >> 12);
+                *out++ = 0x80 | ((c & 0x0FC0) >> 6);
+                *out++ = 0x80 | (c & 0x3F);
+            }
         }
-        else break;
     }
-    return false;
+    return out;
 }
 
-bool endsWithHelper(idx_t from, const String& left, const String& right) {
-    if (from < right.length() - 1) {
-        return false;
+static const char * encodeUtf8(const uchar * src, size_t len) {
+    // Measure first, so the final buffer can be allocated at once.
+    size_t buflen = utf8Length(src, len);
+    char * buf = static_cast<char*>(GC_MALLOC_ATOMIC(buflen + 1));
+    *writeUtf8(src, len, buf) = 0;
+    return buf;
+}
+
+static inline bool isContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// Decodes len bytes of UTF-8 from src into dest, which must have room for
+// len units. Invalid or truncated sequences are replaced by U+FFFD, decoding
+// resumes at the first byte that was not part of the invalid sequence.
+// Returns the amount of units written.
+static size_t decodeUtf8(const char * src, size_t len, uchar * dest) {
+    const unsigned char * in = reinterpret_cast<const unsigned char*>(src);
+    uchar * out = dest;
+    idx_t i = 0;
+    while (i < len) {
+        size_t run = asciiPrefix(src + i, len - i);
+        widen(src + i, run, out);
+        out += run;
+        i += run;
+
+        while (i < len && (in[i] & 0x80)) {
+            unsigned char c = in[i];
+            if ((c & 0xE0) == 0xC0) {
+                // 2-byte
+                if (i + 1 < len && isContinuation(in[i + 1])) {
+                    *out++ = ((c & 0x1F) << 6) | (in[i + 1] & 0x3F);
+                    i += 2;
+                } else {
+                    *out++ = 0xFFFD;
+                    i += 1;
+                }
+            } else if ((c & 0xF0) == 0xE0) {
+                // 3-byte
+                if (i + 2 < len && isContinuation(in[i + 1]) &&
+                        isContinuation(in[i + 2])) {
+                    *out++ = ((c & 0x0F) << 12) | ((in[i + 1] & 0x3F) << 6) |
+                            (in[i + 2] & 0x3F);
+                    i += 3;
+                } else {
+                    *out++ = 0xFFFD;
+                    i += (i + 1 < len && isContinuation(in[i + 1])) ? 2 : 1;
+                }
+            } else if ((c & 0xF8) == 0xF0) {
+                // 4-byte, becomes a surrogate pair
+                if (i + 3 < len && isContinuation(in[i + 1]) &&
+                        isContinuation(in[i + 2]) &&
+                        isContinuation(in[i + 3])) {
+                    uint32_t cp = ((c & 0x07) << 18) |
+                            ((in[i + 1] & 0x3F) << 12) |
+                            ((in[i + 2] & 0x3F) << 6) | (in[i + 3] & 0x3F);
+                    if (cp >= 0x10000 && cp <= 0x10FFFF) {
+                        cp -= 0x10000;
+                        *out++ = 0xD800 | (cp >> 10);
+                        *out++ = 0xDC00 | (cp & 0x3FF);
+                    } else {
+                        // overlong, or beyond U+10FFFF
+                        *out++ = 0xFFFD;
+                    }
+                    i += 4;
+                } else {
+                    *out++ = 0xFFFD;
+                    i += 1;
+                    while (i < len && isContinuation(in[i])) ++i;
+                }
+            } else {
+                // invalid!
+                *out++ = 0xFFFD;
+                i += 1;
+            }
+        }
     }
-    uint32_t count = 0;
-    for (idx_t i = 0; i < right.length(); i++) {
-        if (left.at(from - i) == right.at(-i-1)) {
-            count++;
-            if(count == right.length()) return true;
-        } else break;
+    return out - dest;
+}
+
+// Hashing ////////////////////////////////////////////////////////////
+//
+// wyhash by Wang Yi (public domain): the input is read 8 bytes at a time and
+// folded with 64x64->128 bit multiplications, which mix as well as
+// anything slower would.
+
+static const uint64_t wySecret[4] = {
+    UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47)
+};
+
+// Multiplies a and b, leaving the low half in a and the high half in b.
+static inline void wyMultiply(uint64_t& a, uint64_t& b) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = uint64_t(r);
+    b = uint64_t(r >> 64);
+#else
+    const uint64_t M32 = 0xFFFFFFFF;
+    uint64_t ah = a >> 32, al = a & M32;
+    uint64_t bh = b >> 32, bl = b & M32;
+    uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    uint64_t mid = (ll >> 32) + (lh & M32) + (hl & M32);
+    a = (mid << 32) | (ll & M32);
+    b = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static inline uint64_t wyMix(uint64_t a, uint64_t b) {
+    wyMultiply(a, b);
+    return a ^ b;
+}
+
+static inline uint64_t wyRead8(const byte * p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wyRead4(const byte * p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t wyHash(const byte * p, size_t len, uint64_t seed) {
+    seed ^= wyMix(seed ^ wySecret[0], wySecret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyRead4(p) << 32) | wyRead4(p + ((len >> 3) << 2));
+            b = (wyRead4(p + len - 4) << 32) |
+                    wyRead4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) |
+                    p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wyMix(wyRead8(p) ^ wySecret[1], wyRead8(p + 8) ^ seed);
+                see1 = wyMix(wyRead8(p + 16) ^ wySecret[2],
+                        wyRead8(p + 24) ^ see1);
+                see2 = wyMix(wyRead8(p + 32) ^ wySecret[3],
+                        wyRead8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wyMix(wyRead8(p) ^ wySecret[1], wyRead8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyRead8(p + i - 16);
+        b = wyRead8(p + i - 8);
     }
-    return false;
+    a ^= wySecret[1];
+    b ^= seed;
+    wyMultiply(a, b);
+    return wyMix(a ^ wySecret[0] ^ len, b ^ wySecret[1]);
+}
+
+static inline int32_t hashUnits(const uchar * units, size_t len,
+        uint64_t seed) {
+    uint64_t h = wyHash(reinterpret_cast<const byte*>(units),
+            len * sizeof(uchar), seed);
+    return int32_t(uint32_t(h ^ (h >> 32)));
 }
 
 //////////////////////////////////////////////////////////////////////
 
-String::String() {
-    strdata = new Data(0);
+const size_t String::SmallCapacity;
+
+String::String() : strdata(null), smalllength(0) {
 }
 
 String::String(const char * orig) {
@@ -78,8 +425,21 @@ String::String(const char * orig) {
 }
 
 String::String(const Array<uchar> orig) {
-    strdata = new Data(0);
-    strdata->data = orig.copy();
+    carraycopy(orig.carray(), 0, allocate(orig.length), 0, orig.length);
+}
+
+String::String(const uchar* data, size_t len) {
+    carraycopy(data, 0, allocate(len), 0, len);
+}
+
+String::String(Array<uchar>&& units, size_t len) : strdata(null),
+        smalllength(0) {
+    // Only take the units over if that doesn't waste more than half of them.
+    if (len <= SmallCapacity || len < units.length / 2) {
+        carraycopy(units.carray(), 0, allocate(len), 0, len);
+    } else {
+        strdata = new Data(std::move(units), len);
+    }
 }
 
 String::String(const std::string& orig) {
@@ -87,15 +447,25 @@ String::String(const std::string& orig) {
     fromAscii(orig.c_str());
 }
 
+String::String(const StringLiteral orig) : strdata(null),
+        smalllength(LiteralLength) {
+    static_assert(sizeof(Literal) <= sizeof(smalldata),
+            "a Literal must fit in smalldata");
+    Literal l = { reinterpret_cast<const uchar*>(orig.units), orig.length };
+    std::memcpy(smalldata, &l, sizeof(l));
+}
+
 String::String(const String& orig) {
     // refcounted
-    this->strdata = orig.strdata;
-    this->strdata->refcount++;
+    share(orig);
+}
+
+String::String(String&& orig) {
+    steal(orig);
 }
 
 String::String(const uchar c) {
-    strdata = new Data(1);
-    strdata->data[0] = c;
+    allocate(1)[0] = c;
 }
 
 String::String(const bool b) {
@@ -103,209 +473,284 @@ String::String(const bool b) {
 }
 
 String::String(const int32_t i) {
-    size_t tmplen = sizeof (i) * 5; // long enough, i presume?
-    char * buf = new char[tmplen];
-    sprintf(buf, "%" PRId32, i);
-    fromAscii(buf);
-    delete[] buf;
+    char buf[NumberBufferSize];
+    size_t len = formatInteger(int64_t(i), buf);
+    widen(buf, len, allocate(len));
 }
 
 String::String(const uint32_t i) {
-    size_t tmplen = sizeof (i) * 5; // long enough, i presume?
-    char * buf = new char[tmplen];
-    sprintf(buf, "%" PRIu32, i);
-    fromAscii(buf);
-    delete[] buf;
+    char buf[NumberBufferSize];
+    size_t len = formatInteger(uint64_t(i), buf);
+    widen(buf, len, allocate(len));
 }
 
 String::String(const int64_t l) {
-    size_t tmplen = sizeof (l) * 5; // long enough, i presume?
-    char * buf = new char[tmplen];
-    sprintf(buf, "%" PRId64, l);
-    fromAscii(buf);
-    delete[] buf;
+    char buf[NumberBufferSize];
+    size_t len = formatInteger(l, buf);
+    widen(buf, len, allocate(len));
 }
 
 String::String(const uint64_t l) {
-    size_t tmplen = sizeof (l) * 5; // long enough, i presume?
-    char * buf = new char[tmplen];
-    sprintf(buf, "%" PRIu64, l);
-    fromAscii(buf);
-    delete[] buf;
+    char buf[NumberBufferSize];
+    size_t len = formatInteger(l, buf);
+    widen(buf, len, allocate(len));
 }
 
 String::String(const float f) {
-    if (std::isinf(f)) {
-        if (copysign(1.0, f) == -1.0) {
-            fromAscii("-Infinity");
-        } else {
-            fromAscii("Infinity");
-        }
-    } else if (std::isnan(f)) {
-        fromAscii("NaN");
-    } else {
-        char * buf = static_cast<char*>(GC_MALLOC_ATOMIC(20));
-        sprintf(buf,"%.7g",f);
-        fromAscii(buf);
-    }
+    char buf[NumberBufferSize];
+    size_t len = formatFloat(f, buf);
+    widen(buf, len, allocate(len));
 }
 
 String::String(const double d) {
-    if (std::isinf(d)) {
-        if (copysign(1.0, d) == -1.0) {
-            fromAscii("-Infinity");
-        } else {
-            fromAscii("Infinity");
-        }
-    } else if (std::isnan(d)) {
-        fromAscii("NaN");
-    } else {
-        char * buf = static_cast<char*>(GC_MALLOC_ATOMIC(20));
-        sprintf(buf,"%.16g",d);
-        fromAscii(buf);
-    }
+    char buf[NumberBufferSize];
+    size_t len = formatFloat(d, buf);
+    widen(buf, len, allocate(len));
 }
 
 String::~String() {
-    strdata->refcount--;
-    if (strdata->refcount == 0) {
-        delete strdata;
-        strdata = null;
-    }
+    release();
 }
 
 size_t String::length() const {
-    return strdata->data.length;
+    if (strdata) return strdata->length;
+    return smalllength == LiteralLength ? literal().length : smalllength;
 }
 
-uchar String::at(sidx_t idx) const throw(ArrayException) {
-    try {
-        return strdata->data[idx];
-    } straced;
+uchar String::at(sidx_t idx) const {
+    size_t len = length();
+#if SYLPH_CHECKED_ARRAYS
+    // a negative index wraps around to a huge one
+    if (size_t(idx) < len) return rawdata()[idx];
+    if (idx < 0 && size_t(-idx) <= len) return rawdata()[len + idx];
+    throwArrayOverflow(idx, len, "String");
+#else
+    return rawdata()[idx >= 0 ? idx : len + idx];
+#endif
 }
 
 const char * String::ascii() const {
     // all non-ascii chars will be converted to '?' literals.
     char * buf = (char*)GC_MALLOC_ATOMIC(length() + 1);
-    for (idx_t i = 0; i < length(); i++) {
-        if (at(i) > 0x7F) buf[i] = '?';
-        else buf[i] = at(i);
-    }
+    narrow(rawdata(), length(), buf);
+    buf[length()] = 0;
     return buf;
 }
 
 const char * String::utf8() const {
-    // In the best case, the the buffer need to be length()+1. In the worst
-    // case, it's 3 * length() + 1. Always prepare for the worst ;)
-    char * buf = new char[3 * length() + 1];
-    size_t buflen = 0;
-    for (idx_t i = 0; i < length(); i++) {
-        if (at(i) <= 0x7F) {
-            // ascii
-            buf[buflen] = at(i);
-            buflen++;
-        } else if (at(i) < 0x07FF) {
-            // 2-byte
-            buf[buflen] = 0xC0 | ((at(i) & 0x07C0) >> 6);
-            buf[buflen + 1] = 0x80 | (at(i) & 0x3F);
-            buflen += 2;
-        } else {
-            // 3-byte
-            buf[buflen] = 0xE0 | ((at(i) & 0xF000) >> 12);
-            buf[buflen + 1] = 0x80 | ((at(i) & 0x0FC0) >> 6);
-            buf[buflen + 2] = 0x80 | (at(i) & 0x3F);
-            buflen += 3;
-        }
-    }
-
-    // now copy it to the final buffer...
-    char * final = static_cast<char*>(GC_MALLOC_ATOMIC(buflen + 1));
-    carraycopy(buf, 0, final, 0, buflen);
-    final[buflen] = 0;
-    delete[] buf;
-    return final;
+    if (!strdata) return encodeUtf8(rawdata(), length());
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    const char * cached = strdata->utf8.load(std::memory_order_acquire);
+#else
+    const char * cached = strdata->utf8;
+#endif
+    if (cached) return cached;
+
+    // The data of a String never changes, so the cache never goes stale. If
+    // two threads race here, both results are correct and either one is kept.
+    cached = encodeUtf8(strdata->data.carray(), length());
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    strdata->utf8.store(cached, std::memory_order_release);
+#else
+    strdata->utf8 = cached;
+#endif
+    return cached;
 }
 
 const Array<uchar> String::utf16() const {
-    return strdata->data.copy();
+    Array<uchar> toReturn(length());
+    carraycopy(rawdata(), 0, toReturn.carray(), 0, length());
+    return toReturn;
 }
 
 String String::toLowerCase() const {
-    Array<uchar> dest(length() << 1);
-    UErrorCode error = U_ZERO_ERROR;
-    size_t newlength = u_strToLower((UChar*)dest.carray(), dest.length,
-            (UChar*)strdata->data.carray(), length(), 0, &error);
-    if(U_FAILURE(error)) {
-        sthrow(Exception,u_errorName(error));
+    if (asciiPrefix(rawdata(), length()) == length()) {
+        String toReturn;
+        asciiCase(rawdata(), length(), toReturn.allocate(length()), 'A');
+        return toReturn;
     }
 
-    Array<uchar> toReturn(newlength);
-    arraycopy(dest, 0, toReturn, 0, newlength);
+    uchar small[256];
+    size_t len = length();
+    uchar * buf = icuCase(u_strToLower, rawdata(), len, small, 256);
+    String toReturn(buf, len);
+    if (buf != small) delete[] buf;
     return toReturn;
 }
 
 String String::toUpperCase() const {
-    Array<uchar> dest(length() << 1);
+    if (asciiPrefix(rawdata(), length()) == length()) {
+        String toReturn;
+        asciiCase(rawdata(), length(), toReturn.allocate(length()), 'a');
+        return toReturn;
+    }
+
+    uchar small[256];
+    size_t len = length();
+    uchar * buf = icuCase(u_strToUpper, rawdata(), len, small, 256);
+    String toReturn(buf, len);
+    if (buf != small) delete[] buf;
+    return toReturn;
+}
+
+// Returns ICU's normalizer for the given form.
+static const UNormalizer2 * normalizer(String::NormalForm form) {
     UErrorCode error = U_ZERO_ERROR;
-    size_t newlength = u_strToUpper((UChar*)dest.carray(), dest.length,
-            (UChar*)strdata->data.carray(), length(), 0, &error);
+    const UNormalizer2 * toReturn;
+    switch (form) {
+    case String::NFD:
+        toReturn = unorm2_getNFDInstance(&error);
+        break;
+    case String::NFKC:
+        toReturn = unorm2_getNFKCInstance(&error);
+        break;
+    case String::NFKD:
+        toReturn = unorm2_getNFKDInstance(&error);
+        break;
+    default:
+        toReturn = unorm2_getNFCInstance(&error);
+    }
+    if (U_FAILURE(error)) sthrow(Exception, u_errorName(error));
+    return toReturn;
+}
+
+String String::normalize(NormalForm form) const {
+    const uchar * src = rawdata();
+    const size_t len = length();
+    // ASCII is the same in every normalization form.
+    if (asciiPrefix(src, len) == len) return *this;
 
-    if(U_FAILURE(error)) {
-        sthrow(Exception,u_errorName(error));
+    const UNormalizer2 * norm = normalizer(form);
+    UErrorCode error = U_ZERO_ERROR;
+    size_t span = unorm2_spanQuickCheckYes(norm, (const UChar*)src, len,
+            &error);
+    if (U_FAILURE(error)) sthrow(Exception, u_errorName(error));
+    if (span == len) return *this;
+
+    // Keep the part that is already normalized, and append the rest to it.
+    uchar small[256];
+    size_t capacity = len + 16 > 256 ? len + 16 : 256;
+    uchar * buf = capacity == 256 ? small : new uchar[capacity];
+    int32_t newlength;
+    for (;;) {
+        carraycopy(src, 0, buf, 0, span);
+        error = U_ZERO_ERROR;
+        newlength = unorm2_normalizeSecondAndAppend(norm, (UChar*)buf, span,
+                capacity, (const UChar*)src + span, len - span, &error);
+        if (error != U_BUFFER_OVERFLOW_ERROR) break;
+        if (buf != small) delete[] buf;
+        capacity = newlength;
+        buf = new uchar[capacity];
     }
+    if (U_FAILURE(error)) {
+        if (buf != small) delete[] buf;
+        sthrow(Exception, u_errorName(error));
+    }
+    String toReturn(buf, newlength);
+    if (buf != small) delete[] buf;
+    return toReturn;
+}
 
-    Array<uchar> toReturn(newlength);
-    arraycopy(dest, 0, toReturn, 0, newlength);
+bool String::isNormalized(NormalForm form) const {
+    if (asciiPrefix(rawdata(), length()) == length()) return true;
+    UErrorCode error = U_ZERO_ERROR;
+    UBool toReturn = unorm2_isNormalized(normalizer(form),
+            (const UChar*)rawdata(), length(), &error);
+    if (U_FAILURE(error)) sthrow(Exception, u_errorName(error));
     return toReturn;
 }
 
 bool String::equalsIgnoreCase(const String other) const {
-    return this->toLowerCase() == other.toLowerCase();
+    return compareIgnoreCase(other) == 0;
+}
+
+int String::compareIgnoreCase(const String other) const {
+    const uchar * a = rawdata();
+    const uchar * b = other.rawdata();
+    const size_t alen = length();
+    const size_t blen = other.length();
+    const size_t len = alen < blen ? alen : blen;
+    size_t i = 0;
+#ifdef __SSE2__
+    // Skip over blocks that are ASCII and equal ignoring case; the scalar
+    // loop below finds out what happened in the block that is not.
+    const __m128i high = _mm_set1_epi16(short(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i below = _mm_set1_epi16('A' - 1);
+    const __m128i above = _mm_set1_epi16('Z' + 1);
+    const __m128i flip = _mm_set1_epi16(0x20);
+    for (; i + 8 <= len; i += 8) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i ascii = _mm_cmpeq_epi16(
+                _mm_and_si128(_mm_or_si128(va, vb), high), zero);
+        va = _mm_xor_si128(va, _mm_and_si128(flip, _mm_and_si128(
+                _mm_cmpgt_epi16(va, below), _mm_cmplt_epi16(va, above))));
+        vb = _mm_xor_si128(vb, _mm_and_si128(flip, _mm_and_si128(
+                _mm_cmpgt_epi16(vb, below), _mm_cmplt_epi16(vb, above))));
+        __m128i same = _mm_and_si128(ascii, _mm_cmpeq_epi16(va, vb));
+        if (_mm_movemask_epi8(same) != 0xFFFF) break;
+    }
+#endif
+    for (; i < len; ++i) {
+        uchar ca = a[i];
+        uchar cb = b[i];
+        if ((ca | cb) > 0x7F) {
+            // Everything before i was ASCII and equal, so full Unicode case
+            // folding can take over from here.
+            UErrorCode error = U_ZERO_ERROR;
+            int32_t result = u_strCaseCompare((const UChar*)a + i, alen - i,
+                    (const UChar*)b + i, blen - i, U_FOLD_CASE_DEFAULT,
+                    &error);
+            if (U_FAILURE(error)) sthrow(Exception, u_errorName(error));
+            return result;
+        }
+        if (uchar(ca - 'A') < 26) ca |= 0x20;
+        if (uchar(cb - 'A') < 26) cb |= 0x20;
+        if (ca != cb) return int(ca) - int(cb);
+    }
+    return (alen > blen) - (alen < blen);
 }
 
 bool String::endsWith(const String other) const {
-    return endsWithHelper(-1,*this,other);
+    size_t len = other.length();
+    return len <= length() && std::memcmp(rawdata() + length() - len,
+            other.rawdata(), len * sizeof(uchar)) == 0;
 }
 
 bool String::startsWith(const String other) const {
-    return startsWithHelper(0,*this, other);
+    size_t len = other.length();
+    return len <= length() &&
+            std::memcmp(rawdata(), other.rawdata(), len * sizeof(uchar)) == 0;
 }
 
 bool String::contains(const String other) const {
-    return indexOf(other) != -1;
+    return StringSearcher(other).foundIn(*this);
 }
 
 String String::trim() const {
-    size_t beginct = 0;
-    size_t endct = length() - 1;
-    for (idx_t i = 0; i < this->length(); i++) {
-        if (isspace(this->at(i))) beginct++;
-        else break;
-    }
-    for (idx_t i = (length() - 1); i > 0; i--) {
-        if (isspace(this->at(i))) endct--;
-        else break;
-    }
-    return substring(beginct, endct);
+    return StringView(*this).trim();
 }
 
 Array<String> String::split(Array<uchar> delimiters) const {
-    Vector<String> toReturn;
-
-    idx_t start = 0;
-    idx_t end = 0;
-
-    for(idx_t i = 0; i < length(); ++i) {
-        for(idx_t j = 0; j < delimiters.length; ++j) {
-            if(at(i) == delimiters[j]) {
-                end = i;
-                if(start != end) toReturn.add(substring(start,end-1));
-                start = end + 1;
-            }
-        }
+    StringTokenizer tokenizer(*this, delimiters);
+    Array<String> toReturn(tokenizer.countTokens());
+    idx_t i = 0;
+    for (TokenIterator it = tokenizer.begin(), end = tokenizer.end();
+            it != end; ++it) {
+        toReturn[i++] = *it;
     }
+    return toReturn;
+}
 
-    return toReturn.toArray();
+void String::split(Vector<StringView>& tokens, Array<uchar> delimiters) const {
+    tokens.clear();
+    StringTokenizer tokenizer(*this, delimiters);
+    for (TokenIterator it = tokenizer.begin(), end = tokenizer.end();
+            it != end; ++it) {
+        tokens.add(*it);
+    }
 }
 
 String String::substring(idx_t begin) const throw(ArrayException) {
@@ -313,158 +758,168 @@ String String::substring(idx_t begin) const throw(ArrayException) {
 }
 
 String String::substring(idx_t begin, idx_t end) const throw(ArrayException) {
-    return String(strdata->data[range(begin, end)]);
+    try {
+        return slice(begin, end).toString();
+    } straced;
+}
+
+StringView String::slice(idx_t begin) const throw(ArrayException) {
+    return slice(begin, length()-1);
+}
+
+StringView String::slice(idx_t begin, idx_t end) const throw(ArrayException) {
+    try {
+        return StringView(*this).slice(begin, end);
+    } straced;
 }
 
 sidx_t String::indexOf(const String substr, idx_t start) const
         throw(ArrayException) {
-    if (this->length() - start < substr.length()) return -1;
-    for (idx_t i = start; i < (this->length() - substr.length()); i++) {
-        if(startsWithHelper(i,*this,substr)) {
-            return i;
-        }
-    }
-    return -1;
+    return StringSearcher(substr).indexIn(*this, start);
 }
 
 sidx_t String::lastIndexOf(const String substr) const {
-    return lastIndexOf(substr, length() - 1);
+    return StringSearcher(substr).lastIndexIn(*this);
 }
 
-sidx_t String::lastIndexOf(const String substr, idx_t start) const
+sidx_t String::lastIndexOf(const String substr, idx_t end) const
         throw(ArrayException) {
-    if (start < substr.length()) { 
-        return -1;
-    }
-    for (sidx_t i = start; i >= sidx_t(substr.length() - 1); i--) {
-        if(endsWithHelper(i,*this,substr)) {
-            return i-substr.length() + 1;
-        }
-    }
-    return -1;
+    return StringSearcher(substr).lastIndexIn(*this, end);
 }
 
 String String::copy() const {
-    return strdata->data.copy();
+    return String(rawdata(), length());
 }
 
 bool String::merge(String other) const {
     if (other != *this) return false;
-    else {
-        this->strdata->refcount += other.strdata->refcount;
+    else if (!strdata || !other.strdata) {
+        // inline Strings have nothing to share
+        return true;
+    } else {
+        // Array is refcounted by itself
         other.strdata->data = this->strdata->data;
         return true;
     }
 }
 
+String String::intern() const {
+    return StringPool::global().intern(*this);
+}
+
 String String::fromHex(int i, bool up) {
-    size_t tmplen = sizeof (i) * 5; // long enough, i presume?
-    char * buf = new char[tmplen];
-    sprintf(buf, up ? "%#X" : "%#x", i);
+    char buf[NumberBufferSize];
     String toReturn;
-    delete toReturn.strdata;
-    toReturn.fromAscii(buf);
-    delete[] buf;
+    toReturn.fromAscii(buf, sprintf(buf, up ? "%#X" : "%#x", i));
     return toReturn;
 }
 
 String String::fromOct(int i) {
-    size_t tmplen = sizeof (i) * 5; // long enough, i presume?
-    char * buf = new char[tmplen];
-    sprintf(buf, "%#o", i);
+    char buf[NumberBufferSize];
     String toReturn;
-    delete toReturn.strdata;
-    toReturn.fromAscii(buf);
-    delete[] buf;
+    toReturn.fromAscii(buf, sprintf(buf, "%#o", i));
     return toReturn;
 }
 
 String String::fromSci(float f, bool up) {
-    char * buf = static_cast<char*>(GC_MALLOC_ATOMIC(20));
-    sprintf(buf, up?"%.6E" : "%6e", f);
+    char buf[NumberBufferSize];
     String toReturn;
-    delete toReturn.strdata;
-    toReturn.fromAscii(buf);
-    delete[] buf;
+    toReturn.fromAscii(buf, sprintf(buf, up ? "%.6E" : "%.6e", f));
     return toReturn;
 }
 
 String String::fromSci(double d, bool up) {
-    char * buf = static_cast<char*>(GC_MALLOC_ATOMIC(20));
-    sprintf(buf, up?"%.15E" : "%15e", d);
+    char buf[NumberBufferSize];
     String toReturn;
-    delete toReturn.strdata;
-    toReturn.fromAscii(buf);
-    delete[] buf;
+    toReturn.fromAscii(buf, sprintf(buf, up ? "%.15E" : "%.15e", d));
     return toReturn;
 }
 
 bool String::boolValue() const {
-    String l = (*this & lc);
-    return l == "true" || l == "1" || l == "yes" || l == "on";
+    return equalsIgnoreCase(u"true"_s) || *this == u"1"_s ||
+            equalsIgnoreCase(u"yes"_s) || equalsIgnoreCase(u"on"_s);
 }
 
-int32_t String::intValue() const {
-    int32_t i = 0;
-    sscanf(this->ascii(), "%" SCNd32, &i);
-    return i;
+// Throws for anything but ParseOk.
+static void checkParse(ParseResult result) {
+    if (result == ParseInvalid) {
+        sthrow(ParseException, "Not a number");
+    } else if (result == ParseOutOfRange) {
+        sthrow(ParseException, "Number out of range");
+    }
 }
 
-uint32_t String::uintValue() const {
-    uint32_t i = 0;
-    sscanf(this->ascii(), "%" SCNu32, &i);
-    return i;
+int32_t String::intValue() const throw(ParseException) {
+    StringView trimmed = StringView(*this).trim();
+    int64_t l = 0;
+    ParseResult result = parseInteger(trimmed.data(), trimmed.length(), l);
+    if (result == ParseOk && (l < INT32_MIN || l > INT32_MAX)) {
+        result = ParseOutOfRange;
+    }
+    checkParse(result);
+    return int32_t(l);
 }
 
-int64_t String::longValue() const {
+uint32_t String::uintValue() const throw(ParseException) {
+    StringView trimmed = StringView(*this).trim();
+    uint64_t l = 0;
+    ParseResult result = parseInteger(trimmed.data(), trimmed.length(), l);
+    if (result == ParseOk && l > UINT32_MAX) result = ParseOutOfRange;
+    checkParse(result);
+    return uint32_t(l);
+}
+
+int64_t String::longValue() const throw(ParseException) {
+    StringView trimmed = StringView(*this).trim();
     int64_t l = 0;
-    sscanf(this->ascii(), "%" SCNd64, &l);
+    checkParse(parseInteger(trimmed.data(), trimmed.length(), l));
     return l;
 }
 
-uint64_t String::ulongValue() const {
+uint64_t String::ulongValue() const throw(ParseException) {
+    StringView trimmed = StringView(*this).trim();
     uint64_t l = 0;
-    sscanf(this->ascii(), "%" SCNu64, &l);
+    checkParse(parseInteger(trimmed.data(), trimmed.length(), l));
     return l;
 }
 
-float String::floatValue() const {
-    if (*this == "NaN") return 0.0f / 0.0f;
-    else if (*this == "Infinity") return 1.0f / 0.0f;
-    else if (*this == "-Infinity") return -1.0f / 0.0f;
+float String::floatValue() const throw(ParseException) {
+    StringView trimmed = StringView(*this).trim();
     float f = 0;
-    sscanf(this->ascii(), "%f", &f);
+    checkParse(parseFloat(trimmed.data(), trimmed.length(), f));
     return f;
 }
 
-double String::doubleValue() const {
-    if (*this == "NaN") return 0.0 / 0.0;
-    else if (*this == "Infinity") return 1.0 / 0.0;
-    else if (*this == "-Infinity") return -1.0 / 0.0;
+double String::doubleValue() const throw(ParseException) {
+    StringView trimmed = StringView(*this).trim();
     double d = 0;
-    sscanf(this->ascii(), "%lf", &d);
+    checkParse(parseFloat(trimmed.data(), trimmed.length(), d));
     return d;
 }
 
 const String& String::operator=(const char * orig) const {
-    strdata->refcount--;
-    if (strdata->refcount == 0) delete strdata;
+    release();
     fromUtf8(orig);
     return *this;
 }
 
 const String& String::operator=(const std::string & orig) const {
-    strdata->refcount--;
-    if (strdata->refcount == 0) delete strdata;
+    release();
     fromAscii(orig.c_str());
     return *this;
 }
 
-const String& String::operator=(const String orig) const {
-    strdata->refcount--;
-    if (strdata->refcount == 0) delete strdata;
-    strdata = orig.strdata;
-    strdata->refcount++;
+const String& String::operator=(const String& orig) const {
+    if (this == &orig) return *this;
+    release();
+    share(orig);
+    return *this;
+}
+
+const String& String::operator=(String&& orig) const {
+    if (this == &orig) return *this;
+    release();
+    steal(orig);
     return *this;
 }
 
@@ -477,106 +932,149 @@ String::operator std::string() const {
 }
 
 void String::fromAscii(const char* ascii) const {
+    fromAscii(ascii, std::strlen(ascii));
+}
+
+void String::fromAscii(const char* ascii, size_t len) const {
     // no conversion required. Just plain ol' copy.
-    strdata = new Data(std::strlen(ascii));
-    for (idx_t i = 0; i < std::strlen(ascii); i++) {
-        strdata->data[i] = ascii[i];
-    }
+    widen(ascii, len, allocate(len));
 }
 
 void String::fromUtf8(const char* unicode) const {
-    size_t len = std::strlen(unicode);
-    StringBuffer buf;
-    uchar current = 0;
-    byte bytecount = 0;
-    for (idx_t i = 0; i < len; i++) {
-        unsigned char univalue = static_cast<unsigned char> (unicode[i]);
-        switch (bytecount) {
-            case 0:
-                if (univalue <= 0x7F) {
-                    // ascii
-                    buf << (char) univalue;
-                } else if ((univalue | 0x1F) == 0xDF) {
-                    // start of 2-byte char
-                    bytecount = 1;
-                    current = (univalue & 0x1F) << 6;
-                } else if ((univalue | 0x0F) == 0xEF) {
-                    // start of 3-byte char
-                    bytecount = 2;
-                    current = (univalue & 0x0F) << 12;
-                } else if ((univalue | 0x07) == 0xF7) {
-                    // start of 4-byte char, unsupported!
-                    buf << (uchar)0xFFFD; // That's such a nice ? in a black diamond.
-                    i += 3;
-                } else {
-                    // invalid!
-                    buf << (uchar)0xFFFD;
-                }
-                break;
-            case 1:
-                if ((univalue | 0x3F) != 0xBF) {
-                    // invalid followup
-                    bytecount = 0;
-                    buf << (uchar)0xFFFD;
-                } else {
-                    current += (univalue & 0x3F);
-                    buf << (uchar)current;
-                    bytecount = 0;
-                }
-                break;
-            case 2: case 3:
-                if ((univalue | 0x3F) != 0xBF) {
-                    // invalid followup
-                    i += bytecount - 1;
-                    bytecount = 0;
-                    buf << (uchar)0xFFFD;
-                } else {
-                    current += (univalue & 0x3F) << 6;
-                    bytecount--;
-                }
-                break;
-            default:
-                // okaay... somehow, an error occured.
-                // Todo: add a 'this is plainly impossible' statement.
-                break;
+    fromUtf8(unicode, std::strlen(unicode));
+}
+
+void String::fromUtf8(const char* unicode, size_t len) const {
+    size_t ascii = asciiPrefix(unicode, len);
+    if (ascii == len) {
+        // pure ASCII, the length is known up front
+        widen(unicode, len, allocate(len));
+        return;
+    }
 
+    // A UTF-8 String never has more UTF-16 units than bytes.
+    uchar small[SmallCapacity];
+    uchar * buf = len <= SmallCapacity ? small : new uchar[len];
+    widen(unicode, ascii, buf);
+    size_t newlen = ascii + decodeUtf8(unicode + ascii, len - ascii,
+            buf + ascii);
+    carraycopy(buf, 0, allocate(newlen), 0, newlen);
+    if (buf != small) delete[] buf;
+}
+
+uchar* String::allocate(size_t len) const {
+    // Expects this String not to refer to any data.
+    if (len <= SmallCapacity) {
+        strdata = null;
+        smalllength = len;
+        return smalldata;
+    } else {
+        strdata = new Data(len);
+        return strdata->data.carray();
+    }
+}
+
+void String::share(const String& other) const {
+    strdata = other.strdata;
+    if (strdata) {
+        strdata->refcount.acquire();
+    } else {
+        smalllength = other.smalllength;
+        if (smalllength == LiteralLength) {
+            std::memcpy(smalldata, other.smalldata, sizeof(Literal));
+        } else {
+            carraycopy(other.smalldata, 0, smalldata, 0, smalllength);
         }
     }
-    String tmp = buf.toString();
-    strdata = tmp.strdata;
-    strdata->refcount++;
 }
 
-bool operator==(const String lhs, const String rhs) {
-    if (lhs.length() != rhs.length()) return false;
-    for (idx_t i = 0; i < lhs.length(); i++) {
-        if (lhs.at(i) != rhs.at(i)) return false;
+void String::steal(String& other) const {
+    if (other.strdata) {
+        // The data changes owner, so its reference count stays the same.
+        strdata = other.strdata;
+        other.strdata = null;
+    } else {
+        share(other);
     }
-    return true;
+    other.smalllength = 0;
 }
 
-bool operator<(const String lhs, const String rhs) {
-    String l = lhs.length() < rhs.length() ? lhs : rhs;
-    String r = lhs.length() < rhs.length() ? rhs : lhs;
-    for (idx_t i = 0; i < l.length(); i++) {
-        if (l.at(i) == r.at(i)) continue;
-        else if (l.at(i) > l.at(i)) return false;
-        else return true;
+void String::release() const {
+    if (strdata) {
+        if (strdata->refcount.release()) delete strdata;
+        strdata = null;
     }
-    return true;
+    smalllength = 0;
+}
+
+size_t String::utf8Size(const uchar* src, size_t len) {
+    return utf8Length(src, len);
+}
+
+size_t String::writeUtf8(const uchar* src, size_t len, char* dest) {
+    return Sylph::writeUtf8(src, len, dest) - dest;
+}
+
+size_t String::readUtf8(const char* src, size_t len, uchar* dest) {
+    return decodeUtf8(src, len, dest);
+}
+
+const uchar* String::rawdata() const {
+    if (strdata) return strdata->data.carray();
+    return smalllength == LiteralLength ? literal().data : smalldata;
+}
+
+String::Literal String::literal() const {
+    Literal toReturn;
+    std::memcpy(&toReturn, smalldata, sizeof(toReturn));
+    return toReturn;
+}
+
+// Returns the index of the first unit in which a and b differ, or len if
+// they are equal.
+static size_t mismatch(const uchar * a, const uchar * b, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 8 <= len; i += 8) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(va, vb));
+        if (mask != 0xFFFF) return i + (__builtin_ctz(~mask) >> 1);
+    }
+#endif
+    while (i < len && a[i] == b[i]) ++i;
+    return i;
+}
+
+bool operator==(const String& lhs, const String& rhs) {
+    // Copies and interned Strings share their data.
+    if (lhs.strdata && lhs.strdata == rhs.strdata) return true;
+    if (lhs.length() != rhs.length()) return false;
+    return std::memcmp(lhs.rawdata(), rhs.rawdata(),
+            lhs.length() * sizeof(uchar)) == 0;
+}
+
+bool operator<(const String& lhs, const String& rhs) {
+    if (lhs.strdata && lhs.strdata == rhs.strdata) return false;
+    size_t len = lhs.length() < rhs.length() ? lhs.length() : rhs.length();
+    const uchar * l = lhs.rawdata();
+    const uchar * r = rhs.rawdata();
+    size_t i = mismatch(l, r, len);
+    if (i == len) return lhs.length() < rhs.length();
+    return l[i] < r[i];
 }
 
 const String& String::operator+=(const String rhs) const {
-    Data * newdata = new Data(length() + rhs.length());
-    arraycopy(strdata->data, 0, newdata->data, 0, length());
-    arraycopy(rhs.strdata->data, 0, newdata->data, length(), rhs.length());
-    strdata->refcount--;
-    if (strdata->refcount == 0) delete strdata;
-    strdata = newdata;
+    String tmp;
+    uchar * dest = tmp.allocate(length() + rhs.length());
+    carraycopy(rawdata(), 0, dest, 0, length());
+    carraycopy(rhs.rawdata(), 0, dest, length(), rhs.length());
+    release();
+    share(tmp);
     return *this;
 }
 
-String operator+(const String lhs, const String rhs) {
+String operator+(const String& lhs, const String& rhs) {
     return String(lhs) += rhs;
 }
 
@@ -589,15 +1087,136 @@ String operator&(String(*lhs)(const String), const String rhs) {
 }
 
 String operator*(const String lhs, const size_t len) {
-    StringBuffer buf;
-    for (idx_t i = 0; i < len; i++) {
-        buf << lhs;
+    String toReturn;
+    size_t total = lhs.length() * len;
+    uchar * dest = toReturn.allocate(total);
+    if (total == 0) return toReturn;
+    // copy once, then keep doubling what has been copied so far
+    carraycopy(lhs.rawdata(), 0, dest, 0, lhs.length());
+    for (size_t done = lhs.length(); done < total; done *= 2) {
+        carraycopy(dest, 0, dest, done, done < total - done ? done :
+                total - done);
+    }
+    return toReturn;
+}
+
+std::ostream & operator<<(std::ostream& lhs, const String& rhs) {
+    if (rhs.strdata) return lhs << rhs.utf8();
+
+    // Literals and inline Strings have nowhere to cache their UTF-8, so they
+    // are streamed through a buffer on the stack instead of allocating.
+    const uchar * src = rhs.rawdata();
+    size_t len = rhs.length();
+    char buf[3 * 256];
+    while (len > 0) {
+        size_t chunk = len < 256 ? len : 256;
+        // don't split a surrogate pair
+        if (chunk < len && isHighSurrogate(src[chunk - 1])) --chunk;
+        lhs.write(buf, String::writeUtf8(src, chunk, buf));
+        src += chunk;
+        len -= chunk;
+    }
+    return lhs;
+}
+
+const uint64_t Hash<String>::DefaultSeed;
+
+int32_t Hash<String>::operator()(const String& s) const {
+    // Small Strings are cheaper to hash than to look up a cache for.
+    if (!s.strdata || seed != DefaultSeed) {
+        return hashUnits(s.rawdata(), s.length(), seed);
+    }
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    int32_t cached = s.strdata->hash.load(std::memory_order_relaxed);
+#else
+    int32_t cached = s.strdata->hash;
+#endif
+    if (cached) return cached;
+
+    // As with utf8(), a race only means the hash is computed twice. A hash
+    // that happens to be 0 is simply never cached.
+    cached = hashUnits(s.rawdata(), s.length(), seed);
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    s.strdata->hash.store(cached, std::memory_order_relaxed);
+#else
+    s.strdata->hash = cached;
+#endif
+    return cached;
+}
+
+CodePoints String::codePoints() const {
+    return CodePoints(*this);
+}
+
+CodePointIterator::CodePointIterator(bool begin, const String& str) :
+        super(begin), _str(str), _currentIndex(0), _current(0) {
+    if (_str.empty()) {
+        // begin() == end()
+        super::_end_reached_ = true;
+    } else if (!begin) {
+        // end() points at the last code point
+        size_t len = _str.length();
+        const uchar * d = _str.rawdata();
+        _currentIndex = len - 1;
+        if (len > 1 && isLowSurrogate(d[len - 1]) &&
+                isHighSurrogate(d[len - 2])) {
+            _currentIndex--;
+        }
+    }
+}
+
+CodePointIterator::CodePointIterator(const CodePointIterator& other) :
+        super(other), _str(other._str), _currentIndex(other._currentIndex),
+        _current(other._current) {
+}
+
+bool CodePointIterator::equals(const CodePointIterator& other) const {
+    // Inline Strings and literals have no strdata, so compare what is
+    // iterated over. Copies of the same String share rawdata().
+    return _currentIndex == other._currentIndex &&
+            (_str.rawdata() == other._str.rawdata() ?
+                _str.length() == other._str.length() : _str == other._str);
+}
+
+size_t CodePointIterator::width() const {
+    const uchar * d = _str.rawdata();
+    return (isHighSurrogate(d[_currentIndex]) &&
+            _currentIndex + 1 < _str.length() &&
+            isLowSurrogate(d[_currentIndex + 1])) ? 2 : 1;
+}
+
+const uint32_t& CodePointIterator::current() const {
+    const uchar * d = _str.rawdata();
+    _current = width() == 2 ?
+            combineSurrogates(d[_currentIndex], d[_currentIndex + 1]) :
+            d[_currentIndex];
+    return _current;
+}
+
+bool CodePointIterator::hasNext() const {
+    return _currentIndex + width() < _str.length();
+}
+
+void CodePointIterator::next() {
+    _currentIndex += width();
+}
+
+bool CodePointIterator::hasPrevious() const {
+    return _currentIndex > 0;
+}
+
+void CodePointIterator::previous() {
+    const uchar * d = _str.rawdata();
+    _currentIndex--;
+    if (_currentIndex > 0 && isLowSurrogate(d[_currentIndex]) &&
+            isHighSurrogate(d[_currentIndex - 1])) {
+        _currentIndex--;
     }
-    return buf;
 }
 
-std::ostream & operator<<(std::ostream& lhs, const String rhs) {
-    return lhs << rhs.utf8();
+idx_t CodePointIterator::currentIndex() const {
+    return _currentIndex;
 }
 
 String lc(const String rhs) {
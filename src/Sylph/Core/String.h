@@ -32,11 +32,13 @@
 #include "Hash.h"
 #include "Primitives.h"
 #include "Array.h"
+#include "RefCount.h"
 
 // for convenience
 #include "I18N.h"
 
 #include <string>
+#include <utility>
 
 SYLPH_BEGIN_NAMESPACE
 
@@ -62,6 +64,41 @@ typedef uint16_t uchar;
  */
 static Array<uchar> spacechars = {' ', '\n', '\r', '\f', '\t', '\013'};
 
+class CodePoints;
+class StringView;
+template<class T> class Vector;
+
+/**
+ * A UTF-16 string literal, as created by the @c _s suffix. A String created
+ * from a StringLiteral refers to the literal's static storage directly, so
+ * the text is neither decoded nor copied, and nothing is allocated:
+ * <pre>String greeting = u"Hello, world"_s;</pre>
+ * The @c u prefix makes the compiler encode the literal in UTF-16, the
+ * encoding used by String itself.
+ */
+class StringLiteral {
+public:
+    /**
+     * Creates a StringLiteral. Use the @c _s suffix instead.
+     * @param units The UTF-16 units of the literal, which must have static
+     * storage duration.
+     * @param length The amount of units.
+     */
+    constexpr StringLiteral(const char16_t * units, size_t length) :
+            units(units), length(length) {}
+
+    const char16_t * const units;
+    const size_t length;
+};
+
+/**
+ * Creates a StringLiteral from a UTF-16 string literal.
+ * <pre>if (s == u"true"_s) { ... }</pre>
+ */
+constexpr StringLiteral operator"" _s(const char16_t * units, size_t length) {
+    return StringLiteral(units, length);
+}
+
 /**
  * The String class represents character strings. All strings used in LibSylph
  * are instances of this class. <p>
@@ -77,21 +114,35 @@ static Array<uchar> spacechars = {' ', '\n', '\r', '\f', '\t', '\013'};
  * The specification's UnicodeData.txt and SpecialCasing.txt files are used
  * extensively to provide case mapping. For specific details, please refer
  * to the ICU library documentation.<p>
- * Strings are encoded internally in UTF-16, but only the Basic Multilinguar
- * Plane (up to U+FFFF) is supported. Future versions may add support for the
- * other planes (up to U+10FFFF). In this case, UTF-32 will be used instead.
+ * Strings are encoded internally in UTF-16. Characters outside the Basic
+ * Multilingual Plane (above U+FFFF) are stored as surrogate pairs, therefore
+ * they count as two characters for length() and at(). Use codePoints() to
+ * iterate over the actual Unicode code points.<p>
+ * Short Strings (up to String::SmallCapacity characters) are stored inline
+ * inside the String object itself and do not allocate any memory at all. Only
+ * longer Strings use the reference counted, shared data.
  */
 class String : public virtual Object {
-    friend bool operator==(const String lhs, const String rhs);
-    friend bool operator<(const String lhs, const String rhs);
-    friend String operator+(const String lhs, const String rhs);
+    friend bool operator==(const String& lhs, const String& rhs);
+    friend bool operator<(const String& lhs, const String& rhs);
+    friend String operator+(const String& lhs, const String& rhs);
     //friend String operator%(const String lhs, const String rhs);
     friend String operator&(const String lhs, const String(*rhs)(const String));
     friend String operator&(const String(*lhs)(String), const String rhs);
     friend String operator*(const String lhs, const size_t len);
-    friend std::ostream& operator<<(std::ostream& lhs, const String rhs);
+    friend std::ostream& operator<<(std::ostream& lhs, const String& rhs);
 
     friend struct Hash<String>;
+    friend class CodePointIterator;
+    friend class Collator;
+    friend class Format;
+    friend class FormatArg;
+    friend class Rope;
+    friend class StringMatcher;
+    friend class StringBuffer;
+    friend class StringSearcher;
+    friend class StringView;
+    friend class Utf8Buffer;
 
 public:
     /**
@@ -111,7 +162,8 @@ public:
      * The character array passed is expected to be encoded in UTF-8. Any other
      * encodings, or invalid UTF-8, may result in Unicode replacement
      * characters ('�', U+FFFD) to be inserted into the character sequence.<p>
-     * The characters in the original string will be converted to UTF-16.
+     * The characters in the original string will be converted to UTF-16,
+     * characters above U+FFFF become surrogate pairs.
      * The original string will not be modified.<p>
      * An example:
      * <pre>String foo = "abc";
@@ -139,6 +191,13 @@ public:
      * @param orig A standard library string to convert to a String.
      */
     String(const std::string & orig);
+    /**
+     * Creates a String from a string literal. The String refers to the
+     * literal's static storage, nothing is copied or allocated.
+     * <pre>String foo = u"abc"_s;</pre>
+     * @param orig A literal created with the @c _s suffix.
+     */
+    String(const StringLiteral orig);
     /**
      * Creates a String referring to the other String's data. This constructor
      * will not make a full copy of the data contained by the original string,
@@ -149,6 +208,12 @@ public:
      * @param orig A string to share string data with.
      */
     String(const String& orig);
+    /**
+     * Creates a String taking over the other String's data. The reference
+     * count of the data does not change, and the other String is left empty.
+     * @param orig A string to take the string data from.
+     */
+    String(String&& orig);
     /**
      * Creates a String from a single character. The length of the String will
      * be 1. The character is copied into the String.
@@ -219,24 +284,23 @@ public:
      * "Infinity" will be produced. In case of a negative infinity (produced if
      * either one of the operands, but not both, are negative), as per the above
      * rule the literal string "-Infinity" will be produced.</li>
-     * <li>If the magnitude is an integer, i.e. there is no decimal fraction,
-     * the actual conversion will be done by the integer conversion algorithm.
-     * </li>
+     * <li>Otherwise the magnitude is written with the fewest significant
+     * digits that still convert back to exactly the same float. If several
+     * choices are equally short, the one closest to the float is taken. This
+     * means that e.g. 0.1f gives "0.1", and 1.0f / 3 gives "0.33333334".</li>
      * <li>If the magnitude is greater than or equal to 10<sup>-4</sup>, but
-     * less than 10<sup>7</sup> then it is represented as the integer part
-     * in decimal form with no leading zeroes, followed by a dot ('.', U+002E),
-     * followed by up to 8 digits representing the fractional part. No trailing
-     * zeroes will be put in the resulting string.</li>
-     * <li>If the magnitude is greater than or equal to 10<sup>7</sup>, or less
-     * than 10<sup>-4</sup>, the number will be represented in scientific
-     * notation. It is composed of a single significant digit, followed by an
-     * optional decimal fraction and an exponent. The decimal fraction consists
-     * of a dot ('.', U+002E) and up to 8 significant digits without trailing
-     * zeroes. The exponent is of the form @c eN, where N is a integer,
-     * optionally with a minus sign for a negative exponent.</li>
+     * less than 10<sup>7</sup>, it is written in fixed notation: the integer
+     * part in decimal form with no leading zeroes, followed by a dot ('.',
+     * U+002E) and the fractional part if there is one. No trailing zeroes will
+     * be put in the resulting string, so an integral magnitude has no dot.</li>
+     * <li>Otherwise the number will be represented in scientific notation. It
+     * is composed of a single significant digit, followed by an optional dot
+     * and the remaining significant digits, and an exponent of the form
+     * @c e+NN or @c e-NN with at least two digits, e.g. "1e+20" or
+     * "1.234e-05".</li>
      * </ul></li></ul><p>
      * The resulting String will match the regex @c
-     * -?(Infinity|[0-9]*(\.[0-9]{7}[1-9])?(e-?[0-9]*)?) .
+     * -?(Infinity|[0-9]+(\.[0-9]+)?(e[+-][0-9]{2,3})?)|NaN .
      * @param f A floating point number to a String.
      */
     String(const float f);
@@ -259,24 +323,24 @@ public:
      * "Infinity" will be produced. In case of a negative infinity (produced if
      * either one of the operands, but not both, are negative), as per the above
      * rule the literal string "-Infinity" will be produced.</li>
-     * <li>If the magnitude is an integer, i.e. there is no decimal fraction,
-     * the actual conversion will be done by the integer conversion algorithm.
-     * </li>
+     * <li>Otherwise the magnitude is written with the fewest significant
+     * digits that still convert back to exactly the same double. If several
+     * choices are equally short, the one closest to the double is taken. This
+     * means that e.g. 0.1 gives "0.1", but 0.1 + 0.2 gives
+     * "0.30000000000000004".</li>
      * <li>If the magnitude is greater than or equal to 10<sup>-4</sup>, but
-     * less than 10<sup>7</sup> then it is represented as the integer part
-     * in decimal form with no leading zeroes, followed by a dot ('.', U+002E),
-     * followed by up to 16 digits representing the fractional part. No trailing
-     * zeroes will be put in the resulting string.</li>
-     * <li>If the magnitude is greater than or equal to 10<sup>7</sup>, or less
-     * than 10<sup>-4</sup>, the number will be represented in scientific
-     * notation. It is composed of a single significant digit, followed by an
-     * optional decimal fraction and an exponent. The decimal fraction consists
-     * of a dot ('.', U+002E) and up to 16 significant digits without trailing
-     * zeroes. The exponent is of the form @c eN, where N is a integer,
-     * optionally with a minus sign for a negative exponent.</li>
+     * less than 10<sup>16</sup>, it is written in fixed notation: the integer
+     * part in decimal form with no leading zeroes, followed by a dot ('.',
+     * U+002E) and the fractional part if there is one. No trailing zeroes will
+     * be put in the resulting string, so an integral magnitude has no dot.</li>
+     * <li>Otherwise the number will be represented in scientific notation. It
+     * is composed of a single significant digit, followed by an optional dot
+     * and the remaining significant digits, and an exponent of the form
+     * @c e+NN or @c e-NN with at least two digits, e.g. "1e+20" or
+     * "1.234e-05".</li>
      * </ul></li></ul><p>
      * The resulting String will match the regex @c
-     * -?(Infinity|[0-9]*(\.[0-9]{15}[1-9])?(e-?[0-9]*)?) .
+     * -?(Infinity|[0-9]+(\.[0-9]+)?(e[+-][0-9]{2,3})?)|NaN .
      * @param d A double-width floating point number.
      */
     String(const double d);
@@ -306,12 +370,15 @@ public:
 
     /**
      * Returns the character at the specified index. The index is 0-based and
-     * has a maximal value of length() - 1.
-     * @throw ArrayException if <code>idx > length() - 1</code>.
+     * has a maximal value of length() - 1. Negative indices count from the
+     * end.
+     * @throw ArrayException if <code>idx >= length()</code> or
+     * <code>idx < -length()</code>, unless the library was built with
+     * @c SYLPH_UNCHECKED_ARRAYS
      * @param idx the index of the character to return
      * @return the character at the specified index, in UTF-16.
      */
-    uchar at(sidx_t idx) const throw(ArrayException);
+    uchar at(sidx_t idx) const;
 
     /**
      * Converts the String to ASCII. The conversion algorithm goes as follows:
@@ -336,9 +403,14 @@ public:
      * worst case (i.e CJK or other high Unicode characters) it's
      * <code>3 * length() + 1</code>.</p>
      * The returned buffer is null-terminated, and does not contain excess
-     * space. It is not managed by LibSylph, you need to delete it yourself.
-     * Future versions may change this behaviour, and manage the buffer with
-     * LibSylph's garbage collector.
+     * space. It is managed by LibSylph's garbage collector, you must not
+     * delete it yourself.<p>
+     * For Strings with shared data, the conversion is done only once: the
+     * result is cached in the shared data, and every further call on this
+     * String or any String sharing its data returns the same buffer. Strings
+     * stored inline and Strings created from a StringLiteral have no shared
+     * data, so they are converted again, into a new buffer, on every call.
+     * Make a String::copy() of a long literal that is converted often.
      * @return A c-style Unicode string encoded in UTF-8.
      */
     const char* utf8() const;
@@ -358,7 +430,9 @@ public:
     /**
      * Converts the String to lower case. The exact contents of the lower case
      * string are dependant on the characters and the locale used, the resulting
-     * string may be shorter or longer than the original.
+     * string may be shorter or longer than the original. Pure ASCII Strings
+     * are converted directly, several characters at a time; only other
+     * Strings are handed to ICU.
      * @return A lower case version of this String
      */
     String toLowerCase() const;
@@ -366,20 +440,67 @@ public:
     /**
      * Converts the String to upper case. The exact contents of the upper case
      * string are dependant on the characters and the locale used, the resulting
-     * string may be shorter or longer than the original.
+     * string may be shorter or longer than the original. Pure ASCII Strings
+     * are converted directly, several characters at a time.
      * @return An upper case version of this String
      */
     String toUpperCase() const;
 
+    /**
+     * The Unicode normalization forms, see normalize().
+     */
+    enum NormalForm {
+        /** Canonical decomposition followed by canonical composition. */
+        NFC,
+        /** Canonical decomposition. */
+        NFD,
+        /** Compatibility decomposition followed by canonical composition. */
+        NFKC,
+        /** Compatibility decomposition. */
+        NFKD
+    };
+
+    /**
+     * Converts the String to the given Unicode normalization form. Strings
+     * that look the same, like <code>"\u00E9"</code> and
+     * <code>"e\u0301"</code>, are only equal to each other once both are
+     * normalized to the same form. Most text is already in NFC; a String
+     * that is already normalized is recognized with a quick check and
+     * returned as it is, without allocating anything.
+     * @param form The normalization form to convert to.
+     * @return A normalized version of this String.
+     */
+    String normalize(NormalForm form = NFC) const;
+
+    /**
+     * Checks whether the String is in the given Unicode normalization form.
+     * @param form The normalization form to check for.
+     * @return @em true if <code>normalize(form)</code> would return a String
+     * equal to this one, @em false otherwise.
+     */
+    bool isNormalized(NormalForm form = NFC) const;
+
     /**
      * Compares two strings ignoring differencies in case. This is the same as
-     * <code>s.toLowerCase() == t.toLowerCase()</code>.
+     * <code>s.compareIgnoreCase(t) == 0</code>.
      * @param other A string to compare to
      * @return @em true if both Strings are equal ignoring case, @em false
      * otherwise.
      */
     bool equalsIgnoreCase(const String other) const;
 
+    /**
+     * Compares two strings ignoring differences in case, using Unicode case
+     * folding, so that e.g. <code>"Stra\u00DFe"</code> equals
+     * <code>"STRASSE"</code>. Nothing is allocated: both Strings are folded
+     * as they are compared, and the comparison stops at the first
+     * difference. Runs of ASCII are compared several characters at a time.
+     * @param other A string to compare to
+     * @return A negative number if this String sorts before the other one
+     * once case folded, 0 if they are equal, a positive number otherwise.
+     */
+    int compareIgnoreCase(const String other) const;
+
     /**
      * Checks if the string ends with the given suffix.
      * @param other A suffix to test for.
@@ -417,6 +538,20 @@ public:
      */
     Array<String> split(Array<uchar> delimiters = spacechars) const;
 
+    /**
+     * Tokenizes a string into a given Vector. This works like
+     * split(Array<uchar>), but returns the tokens as views on this String, and
+     * stores them in a Vector supplied by the caller. The Vector is cleared
+     * first; by reusing the same Vector, e.g. for every line of a file, the
+     * tokens can be found without allocating any memory.
+     * StringView.h has to be included to use the tokens.
+     * @param tokens The Vector to store the tokens in.
+     * @param delimiters A set of delimiters, by default equal to @c spacechars.
+     * @see StringTokenizer
+     */
+    void split(Vector<StringView>& tokens,
+            Array<uchar> delimiters = spacechars) const;
+
     /**
      * Returns a new String containing all characters from the given index to
      * the end of the String. The index is 0-based. The length of the new
@@ -441,6 +576,29 @@ public:
     String substring(idx_t begin, idx_t end) const
             throw(ArrayException);
 
+    /**
+     * Returns a view on all characters from the given index to the end of the
+     * String. Unlike substring(), this does not copy any characters.
+     * StringView.h has to be included to use the returned view.
+     * @param begin The first index of the view.
+     * @return A view on this String from the given begin index.
+     * @throw ArrayException if <code>begin >= length()</code>.
+     */
+    StringView slice(idx_t begin) const throw(ArrayException);
+
+    /**
+     * Returns a view on all characters from the given begin index up to and
+     * including the given end index. Unlike substring(), this does not copy
+     * any characters. StringView.h has to be included to use the returned
+     * view.
+     * @param begin The first index of the view.
+     * @param end The last index of the view.
+     * @return A view on the given range of this String.
+     * @throw ArrayException if <code>begin >= length() || end >= length() ||
+     * begin > end</code>.
+     */
+    StringView slice(idx_t begin, idx_t end) const throw(ArrayException);
+
     /**
      * Returns the first index from given start index in this String on which
      * the specified substring occurs. The index is 0-based.
@@ -448,7 +606,9 @@ public:
      * @param start The first index to start looking for.
      * @return If the substring occurs in this String, then the index of the
      * first character of that substring is returned, else -1 is returned.
+     * An empty substring is found at @c start.
      * @throw ArrayException if <code>start >= length()</code>
+     * @see StringSearcher for searching the same substring repeatedly.
      */
     sidx_t indexOf(const String substr, idx_t start = 0) const
             throw(ArrayException);
@@ -466,7 +626,8 @@ public:
      * Returns the last index in this String up to given end index
      * on which the specified substring  occurs. The index is 0-based.
      * @param substr The substring to search for.
-     * @param end The last position to search on.
+     * @param end The last position an occurrence of the substring may
+     * cover.
      * @return If the substring occurs in this String, then the index of the
      * first character of that substring is returned, else -1 is returned.
      * @throw ArrayException if <code>end >= length()</code>
@@ -477,6 +638,16 @@ public:
     String copy() const;
     bool merge(String other) const;
 
+    /**
+     * Returns the canonical String with the same contents as this one, from
+     * the global StringPool. All Strings interned from equal contents share
+     * their data, and compare equal without looking at their characters.
+     * <pre>String key = readKey().intern();</pre>
+     * @return A String equal to this one.
+     * @see StringPool
+     */
+    String intern() const;
+
     /**
      * Creates a string from a hexadecimal number. The returned string will
      * match the regex <code>0[xX][0-9a-fA-F]+</code>.
@@ -523,41 +694,64 @@ public:
 
     /**
      * Interprets this string as a signed 32-bit integer. The string has to
-     * match the regex <code>-?[0-9]+</code> after removing leading and trailing
-     * whitespace.
-     * @return The value of the integer interpreting this String in base 10. If
-     * the String does not match the given regex, 0 is returned.
+     * match the regex <code>[+-]?[0-9]+</code> after removing leading and
+     * trailing whitespace. The locale is not taken into account.
+     * @return The value of the integer interpreting this String in base 10.
+     * @throw ParseException If the String does not match the given regex, or
+     * if the integer does not fit in 32 bits.
      */
-    int32_t intValue() const;
+    int32_t intValue() const throw(ParseException);
 
     /**
      * Interprets this string as an unsigned 32-bit integer. The string has to
-     * match the regex <code>[0-9]+</code> after removing leading and trailing
+     * match the regex <code>+?[0-9]+</code> after removing leading and trailing
      * whitespace.
-     * @return The value of the integer interpreting this String in base 10. If
-     * the String does not match the given regex, 0 is returned.
+     * @return The value of the integer interpreting this String in base 10.
+     * @throw ParseException If the String does not match the given regex, or
+     * if the integer does not fit in 32 bits.
      */
-    uint32_t uintValue() const;
+    uint32_t uintValue() const throw(ParseException);
 
     /**
      * Interprets this string as a signed 64-bit integer. The string has to
-     * match the regex <code>-?[0-9]+</code> after removing leading and trailing
-     * whitespace.
-     * @return The value of the integer interpreting this String in base 10. If
-     * the String does not match the given regex, 0 is returned.
+     * match the regex <code>[+-]?[0-9]+</code> after removing leading and
+     * trailing whitespace.
+     * @return The value of the integer interpreting this String in base 10.
+     * @throw ParseException If the String does not match the given regex, or
+     * if the integer does not fit in 64 bits.
      */
-    int64_t longValue() const;
+    int64_t longValue() const throw(ParseException);
 
     /**
      * Interprets this string as an unsigned 64-bit integer. The string has to
-     * match the regex <code>[0-9]+</code> after removing leading and trailing
+     * match the regex <code>+?[0-9]+</code> after removing leading and trailing
      * whitespace.
-     * @return The value of the integer interpreting this String in base 10. If
-     * the String does not match the given regex, 0 is returned.
+     * @return The value of the integer interpreting this String in base 10.
+     * @throw ParseException If the String does not match the given regex, or
+     * if the integer does not fit in 64 bits.
+     */
+    uint64_t ulongValue() const throw(ParseException);
+
+    /**
+     * Interprets this string as a float. After removing leading and trailing
+     * whitespace, the string has to be a decimal number such as
+     * <code>-1.5e+3</code>, or one of <code>NaN</code>, <code>Infinity</code>
+     * and <code>-Infinity</code>. The result is correctly rounded, and the
+     * locale is not taken into account.
+     * @return The float closest to the number in this String.
+     * @throw ParseException If the String is not a number, or if the number is
+     * too large for a float.
+     */
+    float floatValue() const throw(ParseException);
+
+    /**
+     * Interprets this string as a double.
+     * @return The double closest to the number in this String.
+     * @throw ParseException If the String is not a number, or if the number is
+     * too large for a double.
+     * @see floatValue()
      */
-    uint64_t ulongValue() const;
-    float floatValue() const;
-    double doubleValue() const;
+    double doubleValue() const throw(ParseException);
 
     inline bool toBool() const {
         return !empty();
@@ -565,7 +759,8 @@ public:
 
     const String & operator=(const char * orig) const;
     const String & operator=(const std::string & orig) const;
-    const String & operator=(const String orig)const;
+    const String & operator=(const String& orig) const;
+    const String & operator=(String&& orig) const;
 
     /**
      * Appends given String to this String. The internally shared data will be
@@ -594,76 +789,204 @@ public:
      */
     operator std::string() const;
 
+    /**
+     * Returns an iterable over the Unicode code points of this String. Unlike
+     * at(), which returns single UTF-16 units, this combines surrogate pairs
+     * into a single code point. Unpaired surrogates are returned as they are.
+     * <pre>for (uint32_t cp : s.codePoints()) { ... }</pre>
+     * @return The code points in this String.
+     */
+    CodePoints codePoints() const;
+
+    /**
+     * The maximal length of a String that is stored inline, i.e. without
+     * allocating any shared data.
+     */
+    static const size_t SmallCapacity = 11;
+
 private:
+    String(const uchar* data, size_t len);
+    // Takes over units, of which the first len are used.
+    String(Array<uchar>&& units, size_t len);
+
     void fromAscii(const char* ascii) const;
+    void fromAscii(const char* ascii, size_t len) const;
     void fromUtf8(const char* unicode) const;
+    void fromUtf8(const char* unicode, size_t len) const;
+
+    uchar* allocate(size_t len) const;
+    void share(const String& other) const;
+    void steal(String& other) const;
+    void release() const;
+    const uchar* rawdata() const;
+
+    // The amount of bytes src takes as UTF-8.
+    static size_t utf8Size(const uchar* src, size_t len);
+    // Writes src as UTF-8 into dest, without a terminating NUL. Returns the
+    // amount of bytes written.
+    static size_t writeUtf8(const uchar* src, size_t len, char* dest);
+    // Decodes len bytes of UTF-8 from src into dest, which must have room
+    // for len units. Returns the amount of units written.
+    static size_t readUtf8(const char* src, size_t len, uchar* dest);
 
     struct Data {
 
-        Data(size_t len) : data(len), refcount(1) { }
+        Data(size_t len) : data(len), length(len), refcount(1), utf8(null),
+                hash(0) { }
+
+        Data(Array<uchar>&& units, size_t len) : data(std::move(units)),
+                length(len), refcount(1), utf8(null), hash(0) { }
 
         virtual ~Data() { }
         Array<uchar> data;
-        mutable size_t refcount;
+        // less than data.length if the data was handed over by a
+        // StringBuffer with room to spare
+        size_t length;
+        mutable RefCount refcount;
+        // lazily created by String::utf8(), collected by the GC
+#ifdef SYLPH_ATOMIC_REFCOUNT
+        mutable std::atomic<const char*> utf8;
+#else
+        mutable const char* utf8;
+#endif
+        // lazily computed by Hash<String> for its default seed, 0 if unknown
+#ifdef SYLPH_ATOMIC_REFCOUNT
+        mutable std::atomic<int32_t> hash;
+#else
+        mutable int32_t hash;
+#endif
     };
+    // A String created from a StringLiteral has no data of its own: its
+    // smalllength is LiteralLength and its smalldata holds a Literal.
+    struct Literal {
+        const uchar* data;
+        size_t length;
+    };
+    static const uint8_t LiteralLength = 0xFF;
+    Literal literal() const;
+
+    // null if this String is stored in smalldata
     mutable Data* strdata;
+    mutable uchar smalldata[SmallCapacity];
+    mutable uint8_t smalllength;
 
 };
 
-bool operator==(const String lhs, const String rhs);
+bool operator==(const String& lhs, const String& rhs);
 
 /**
- * Overridden version of Hash<T> for String.
- * @todo Explain how it works.
+ * Overridden version of Hash<T> for String. The hash is wyhash over the
+ * UTF-16 units of the String, which is fast and spreads even very similar
+ * Strings evenly. A Hash can be given a seed, so that the distribution of
+ * keys over a HashMap cannot be predicted by an outsider. For the default
+ * seed the hash is computed once and cached inside the String's data, so
+ * hashing the same String again, or any copy of it, costs next to nothing.
  */
 template<>
 struct Hash<String> {
+    /**
+     * The seed used by default. Only hashes for this seed get cached.
+     */
+    static const uint64_t DefaultSeed = UINT64_C(0x9E3779B97F4A7C15);
 
-    inline int32_t operator()(String s) const {
-        uint32_t hash = 0;
-        uint32_t x = 0;
-        uint32_t i = 0;
-        uchar * b = s.strdata->data.carray();
-
-        for(i = 0; i < s.length(); b++, i++) {
-            hash = (hash << 4) + (*b);
-            if((x = hash & 0xF0000000L) != 0) {
-                hash ^= (x >> 24);
-            }
-            hash &= ~x;
-        }
-
-        return hash;
-    }
+    /**
+     * Creates a Hash with the given seed.
+     * @param seed The seed to mix into every hash.
+     */
+    explicit Hash(uint64_t seed = DefaultSeed) : seed(seed) {}
+
+    int32_t operator()(const String& s) const;
+
+    uint64_t seed;
 };
 
-inline bool operator==(const String lhs, const char* rhs) {
+inline bool operator==(const String& lhs, const char* rhs) {
     return operator==(lhs, String(rhs));
 }
 
-inline bool operator==(const char* rhs, const String lhs) {
+inline bool operator==(const char* rhs, const String& lhs) {
     return operator==(String(rhs), lhs);
 }
-bool operator<(const String lhs, const String rhs);
-inline bool operator<(const String lhs, const char* rhs) {
+/**
+ * Compares two Strings lexicographically by their UTF-16 code units. A String
+ * that is a prefix of another sorts before it.
+ */
+bool operator<(const String& lhs, const String& rhs);
+inline bool operator<(const String& lhs, const char* rhs) {
     return lhs < String(rhs);
 }
-inline bool operator<(const char* lhs, const String rhs) {
+inline bool operator<(const char* lhs, const String& rhs) {
     return String(lhs) < rhs;
 }
-String operator+(const String lhs, const String rhs);
+String operator+(const String& lhs, const String& rhs);
 //String operator%(const String lhs, const String rhs);
 String operator&(const String lhs, String(*rhs)(const String));
 String operator&(String(*lhs)(const String), const String rhs);
 String operator*(const String lhs, const size_t len);
-std::ostream & operator<<(std::ostream& lhs, const String rhs);
+std::ostream & operator<<(std::ostream& lhs, const String& rhs);
 
 String lc(const String rhs);
 String uc(const String rhs);
 String t(const String rhs);
 
-S_CMP_SEQ(const String)
-S_CMP_SEQ_2(const String,const char*)
+S_CMP_SEQ(const String&)
+S_CMP_SEQ_2(const String&,const char*)
+
+/**
+ * A bidirectional iterator over the Unicode code points in a String. Each step
+ * takes constant time: a surrogate pair is recognised by looking at no more
+ * than two UTF-16 units. The iterator keeps a reference to the String data, so
+ * it stays valid even if the original String is reassigned.
+ */
+class CodePointIterator :
+        public BidirectionalIterator<const uint32_t, CodePointIterator> {
+public:
+    typedef BidirectionalIterator<const uint32_t, CodePointIterator> super;
+
+    CodePointIterator(bool begin = false, const String& str = String());
+    CodePointIterator(const CodePointIterator& other);
+
+    bool equals(const CodePointIterator& other) const;
+    const uint32_t& current() const;
+    bool hasNext() const;
+    void next();
+    bool hasPrevious() const;
+    void previous();
+
+    /**
+     * Returns the index of the UTF-16 unit the current code point starts at.
+     */
+    idx_t currentIndex() const;
+
+private:
+    size_t width() const;
+
+    String _str;
+    idx_t _currentIndex;
+    mutable uint32_t _current;
+};
+
+/**
+ * The code points of a String, as returned by String::codePoints().
+ */
+class CodePoints {
+public:
+    typedef CodePointIterator iterator;
+    typedef CodePointIterator const_iterator;
+
+    explicit CodePoints(const String& str) : _str(str) {}
+
+    iterator begin() const {
+        return iterator(true, _str);
+    }
+
+    iterator end() const {
+        return iterator(false, _str);
+    }
+
+private:
+    String _str;
+};
 
 SYLPH_END_NAMESPACE
 
@@ -24,128 +24,246 @@
  */
 
 #include "StringBuffer.h"
+#include "NumberFormat.h"
 #include "String.h"
 #include "Util.h"
 
+#include <cstring>
+#include <utility>
+
 SYLPH_BEGIN_NAMESPACE
 StringBuffer::StringBuffer(const String s) : buf(s.length()+16),
-        _length(s.length()) {
+        _length(s.length()), _gap(s.length()) {
+    carraycopy(s.rawdata(), 0, buf.carray(), 0, _length);
+}
+
+StringBuffer::StringBuffer(const StringBuffer& other) :
+        buf(other.buf.copy()), _length(other._length), _gap(other._gap) {
+}
+
+StringBuffer::StringBuffer(StringBuffer&& other) :
+        buf(std::move(other.buf)), _length(other._length), _gap(other._gap) {
+    other._length = 0;
+    other._gap = 0;
 }
 
 StringBuffer::~StringBuffer() {
 
 }
 
+StringBuffer& StringBuffer::operator=(const StringBuffer& other) {
+    if (this == &other) return *this;
+    buf = other.buf.copy();
+    _length = other._length;
+    _gap = other._gap;
+    return *this;
+}
+
+StringBuffer& StringBuffer::operator=(StringBuffer&& other) {
+    if (this == &other) return *this;
+    buf = std::move(other.buf);
+    _length = other._length;
+    _gap = other._gap;
+    other._length = 0;
+    other._gap = 0;
+    return *this;
+}
+
 size_t StringBuffer::length() const {
     return _length;
 }
 
+size_t StringBuffer::capacity() const {
+    return buf.length;
+}
+
+void StringBuffer::reserve(size_t capacity) {
+    ensureCapacity(capacity);
+}
+
 void StringBuffer::deleteSubstring(idx_t start, idx_t end) {
     if(start > _length || end > _length || start > end)
         sthrow(ArrayException, "StringBuffer out of bounds!");
     if(start == end) return;
 
-    arraycopy(buf,end,buf,start,end-start);
+    // the removed characters become part of the gap
+    moveGap(end);
+    _gap = start;
     _length -= (end-start);
 }
 
+StringBuffer& StringBuffer::insert(idx_t idx, const String& s) {
+    return insert(idx, s.rawdata(), s.length());
+}
+
+StringBuffer& StringBuffer::insert(idx_t idx, const uchar* units,
+        size_t len) {
+    if(idx > _length) sthrow(ArrayException, "StringBuffer out of bounds!");
+
+    ensureCapacity(_length + len);
+    moveGap(idx);
+    carraycopy(units, 0, buf.carray(), _gap, len);
+    _gap += len;
+    _length += len;
+    return *this;
+}
+
+StringBuffer& StringBuffer::replace(idx_t start, idx_t end,
+        const String& s) {
+    deleteSubstring(start, end);
+    return insert(start, s);
+}
+
 void StringBuffer::clear() {
     buf = Array<uchar>((size_t)16);
     _length = 0;
+    _gap = 0;
 }
 
 const uchar& StringBuffer::at(idx_t idx) const {
-    return buf[idx];
+    if(idx >= _length) sthrow(ArrayException, "StringBuffer out of bounds!");
+    return buf.carray()[idx < _gap ? idx : idx + buf.length - _length];
 }
 
 uchar& StringBuffer::at(idx_t idx) {
-    return buf[idx];
+    if(idx >= _length) sthrow(ArrayException, "StringBuffer out of bounds!");
+    return buf.carray()[idx < _gap ? idx : idx + buf.length - _length];
 }
 
 StringBuffer& StringBuffer::operator<<(bool b) {
-    return *this<<(String(b));
+    return b ? appendAscii("true", 4) : appendAscii("false", 5);
 }
 
 StringBuffer& StringBuffer::operator<<(char c) {
-    ensureCapacity(_length+1);
-    buf[_length] = c;
-    _length++;
+    *extend(1) = static_cast<unsigned char>(c);
     return *this;
 }
 
 StringBuffer& StringBuffer::operator<<(Array<char> c) {
-    ensureCapacity(_length+c.length);
-    for(idx_t i = 0; i < c.length; i++) {
-        operator<<(c[i]);
-    }
-    return *this;
+    return appendAscii(c.carray(), c.length);
 }
 
 StringBuffer& StringBuffer::operator<<(uchar c) {
-    ensureCapacity(_length+1);
-    buf[_length] = c;
-    _length++;
+    *extend(1) = c;
     return *this;
 }
 
 StringBuffer& StringBuffer::operator<<(Array<uchar> c) {
-    ensureCapacity(_length+c.length);
-    for(idx_t i = 0; i < c.length; i++) {
-        operator<<(c[i]);
-    }
-    return *this;
+    return append(c.carray(), c.length);
 }
 
 StringBuffer& StringBuffer::operator<<(int32_t i) {
-    return *this<<(String(i));
+    char num[NumberBufferSize];
+    return appendAscii(num, formatInteger(int64_t(i), num));
 }
 
 StringBuffer& StringBuffer::operator<<(uint32_t i) {
-    return *this<<(String(i));
+    char num[NumberBufferSize];
+    return appendAscii(num, formatInteger(uint64_t(i), num));
 }
 
 StringBuffer& StringBuffer::operator<<(int64_t l) {
-    return *this<<(String(l));
+    char num[NumberBufferSize];
+    return appendAscii(num, formatInteger(l, num));
 }
 
 StringBuffer& StringBuffer::operator<<(uint64_t l) {
-    return *this<<(String(l));
+    char num[NumberBufferSize];
+    return appendAscii(num, formatInteger(l, num));
 }
 
 StringBuffer& StringBuffer::operator<<(float f) {
-    return *this<<(String(f));
+    char num[NumberBufferSize];
+    return appendAscii(num, formatFloat(f, num));
 }
 
 StringBuffer& StringBuffer::operator<<(double d) {
-    return *this<<(String(d));
+    char num[NumberBufferSize];
+    return appendAscii(num, formatFloat(d, num));
 }
 
-StringBuffer& StringBuffer::operator<<(String s) {
-    ensureCapacity(_length + s.length());
-    for(idx_t i = 0; i < s.length(); i++) {
-        operator<<(s.at(i));
+StringBuffer& StringBuffer::operator<<(const String& s) {
+    return append(s.rawdata(), s.length());
+}
+
+StringBuffer& StringBuffer::append(const uchar* units, size_t len) {
+    carraycopy(units, 0, extend(len), 0, len);
+    return *this;
+}
+
+StringBuffer& StringBuffer::appendAscii(const char* ascii, size_t len) {
+    uchar * dest = extend(len);
+    for (idx_t i = 0; i < len; i++) {
+        dest[i] = static_cast<unsigned char>(ascii[i]);
     }
     return *this;
 }
 
-String StringBuffer::toString() const {
-    Array<uchar> toReturn(_length);
-    arraycopy(buf,0,toReturn,0,_length);
-    return String(toReturn);
+String StringBuffer::toString() const & {
+    if(_gap == _length) return String(buf.carray(), _length);
+
+    String toReturn;
+    uchar * dest = toReturn.allocate(_length);
+    size_t tail = _length - _gap;
+    carraycopy(buf.carray(), 0, dest, 0, _gap);
+    carraycopy(buf.carray(), buf.length - tail, dest, _gap, tail);
+    return toReturn;
+}
+
+String StringBuffer::toString() && {
+    moveGap(_length);
+    size_t len = _length;
+    _length = 0;
+    _gap = 0;
+    return String(std::move(buf), len);
 }
 
-StringBuffer::operator String() const {
+StringBuffer::operator String() const & {
     return toString();
 }
 
+StringBuffer::operator String() && {
+    return std::move(*this).toString();
+}
+
 void StringBuffer::ensureCapacity(size_t capacity) {
-    if(buf.length > capacity) return;
+    if(buf.length >= capacity) return;
 
-    size_t newsize = buf.length;
+    // a StringBuffer that was moved from has no buffer left to double
+    size_t newsize = buf.length ? buf.length : 16;
     while(newsize < capacity) newsize = newsize << 1;
     Array<uchar> newbuf(newsize);
-    arraycopy(buf,0,newbuf,0,buf.length);
-    buf = newbuf;
+    // the gap stays where it is, and takes up the new space
+    size_t tail = _length - _gap;
+    carraycopy(buf.carray(),0,newbuf.carray(),0,_gap);
+    carraycopy(buf.carray(),buf.length-tail,newbuf.carray(),newsize-tail,
+            tail);
+    buf = std::move(newbuf);
+}
+
+void StringBuffer::moveGap(idx_t idx) {
+    uchar * data = buf.carray();
+    size_t gap = buf.length - _length;
+    if(idx < _gap) {
+        std::memmove(data + idx + gap, data + idx,
+                (_gap - idx) * sizeof(uchar));
+    } else if(idx > _gap) {
+        std::memmove(data + _gap, data + _gap + gap,
+                (idx - _gap) * sizeof(uchar));
+    }
+    _gap = idx;
+}
+
+uchar* StringBuffer::extend(size_t len) {
+    // Usually the gap is at the end already, with room to spare.
+    if(_gap != _length || buf.length - _length < len) {
+        ensureCapacity(_length + len);
+        moveGap(_length);
+    }
+    uchar * dest = buf.carray() + _length;
+    _length += len;
+    _gap = _length;
+    return dest;
 }
 SYLPH_END_NAMESPACE
 
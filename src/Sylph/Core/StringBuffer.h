@@ -36,33 +36,106 @@ SYLPH_BEGIN_NAMESPACE
 typedef uint16_t uchar;
 
 /**
- * @todo Write documentation!
+ * A mutable sequence of UTF-16 units, to build and edit Strings with.<p>
+ * A StringBuffer is a gap buffer: its free space is kept at the position of
+ * the last edit, rather than always at the end. Appends, and inserts or
+ * deletes close to the previous one, only touch the characters between the
+ * two positions; the rest of the contents stays where it is. Only moving on
+ * to edit somewhere far away costs time proportional to the distance.
  */
 class StringBuffer : public virtual Object {
 public:
     /** */
-    explicit StringBuffer(size_t len = 16) : buf(len), _length(0) {}
-    /** */
+    explicit StringBuffer(size_t len = 16) : buf(len), _length(0), _gap(0) {}
+    /**
+     * Creates a StringBuffer with the contents of a String.
+     */
     StringBuffer(const String);
+    /**
+     * Creates a StringBuffer with a copy of the contents of another one.
+     * Changes to either StringBuffer do not affect the other.
+     */
+    StringBuffer(const StringBuffer& other);
+    /**
+     * Creates a StringBuffer taking over the contents of another one, which
+     * is left empty. Nothing is copied.
+     */
+    StringBuffer(StringBuffer&& other);
     /** */
     virtual ~StringBuffer();
 
+    /**
+     * Replaces the contents of this StringBuffer by a copy of those of
+     * another one.
+     */
+    StringBuffer& operator=(const StringBuffer& other);
+    /**
+     * Takes over the contents of another StringBuffer, which is left empty.
+     */
+    StringBuffer& operator=(StringBuffer&& other);
+
     /** */
     size_t length() const;
-    /** */
+    /**
+     * Returns the amount of characters this StringBuffer can hold before it
+     * has to grow.
+     */
+    size_t capacity() const;
+    /**
+     * Makes sure this StringBuffer can hold at least the given amount of
+     * characters without growing again. Call this before a series of appends
+     * of which the total length is known, so the buffer grows only once.
+     * @param capacity The amount of characters to make room for.
+     */
+    void reserve(size_t capacity);
+    /**
+     * Removes a range of characters.
+     * @param start The index of the first character to remove.
+     * @param end The index after the last character to remove.
+     * @throw ArrayException If the range is not within this StringBuffer.
+     */
     void deleteSubstring(idx_t start, idx_t end);
+    /**
+     * Inserts a String before the given index.
+     * @param idx The index to insert at, up to and including length().
+     * @param s The String to insert.
+     * @throw ArrayException If <code>idx > length()</code>.
+     */
+    StringBuffer& insert(idx_t idx, const String& s);
+    /**
+     * Inserts a number of UTF-16 units before the given index.
+     * @param idx The index to insert at, up to and including length().
+     * @param units The units to insert.
+     * @param len The amount of units to insert.
+     * @throw ArrayException If <code>idx > length()</code>.
+     */
+    StringBuffer& insert(idx_t idx, const uchar* units, size_t len);
+    /**
+     * Replaces a range of characters by a String.
+     * @param start The index of the first character to replace.
+     * @param end The index after the last character to replace.
+     * @param s The String to put in their place.
+     * @throw ArrayException If the range is not within this StringBuffer.
+     */
+    StringBuffer& replace(idx_t start, idx_t end, const String& s);
     /** */
     void clear();
-    /** */
+    /**
+     * Returns the character at the given index.
+     * @throw ArrayException If <code>idx >= length()</code>.
+     */
     const uchar& at(idx_t idx) const;
-    /** */
+    /** @see at(idx_t) const */
     uchar& at(idx_t idx);
 
     /** */
     StringBuffer& operator<<(bool b);
-    /** */
+    /**
+     * Appends a char as the character U+0000 to U+00FF with the same,
+     * unsigned, value. The same goes for format() and Utf8Buffer.
+     */
     StringBuffer& operator<<(char c);
-    /** */
+    /** Appends every char as operator<<(char) does. */
     StringBuffer& operator<<(Array<char> c);
     /** */
     StringBuffer& operator<<(uchar c);
@@ -81,8 +154,14 @@ public:
     /** */
     StringBuffer& operator<<(double d);
     /** */
-    StringBuffer& operator<<(String s);
-    /** */
+    StringBuffer& operator<<(const String& s);
+    /**
+     * Appends a number of UTF-16 units at once.
+     * @param units The units to append.
+     * @param len The amount of units to append.
+     */
+    StringBuffer& append(const uchar* units, size_t len);
+    /** Appends a C string, taken to be UTF-8. */
     StringBuffer& operator<<(const char* s) {
         return operator<<(String(s));
     }
@@ -93,15 +172,37 @@ public:
         return operator<<(t);
     }
 
-    /** */
-    String toString() const;
-    /** */
-    operator String() const;
-    
+    /**
+     * Returns a String with the contents of this StringBuffer, which are
+     * copied.
+     */
+    String toString() const &;
+    /**
+     * Returns a String with the contents of this StringBuffer, which is about
+     * to be discarded. Its buffer is handed over to the String instead of
+     * being copied, unless more than half of the buffer is unused. Use it
+     * as <code>std::move(buf).toString()</code>, or on a temporary. The
+     * StringBuffer is left empty.
+     */
+    String toString() &&;
+    /** */
+    operator String() const &;
+    /** */
+    operator String() &&;
+
 private:
+    friend class Format;
+
+    // The contents are buf[0, _gap) followed by the last _length - _gap
+    // units of buf. The free space in between is the gap.
     Array<uchar> buf;
     size_t _length;
+    idx_t _gap;
     void ensureCapacity(size_t capacity);
+    void moveGap(idx_t idx);
+    // Makes room for len more units at the end, and returns where they go.
+    uchar* extend(size_t len);
+    StringBuffer& appendAscii(const char* ascii, size_t len);
 };
 SYLPH_END_NAMESPACE
 
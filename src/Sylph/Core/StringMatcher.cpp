@@ -0,0 +1,297 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "StringMatcher.h"
+#include "Util.h"
+#include "Vector.h"
+#include "../IO/InputStream.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+// Marks the absence of a state or a pattern.
+static const uint32_t None = uint32_t(-1);
+
+// The start state.
+static const uint32_t Root = 0;
+
+// Above this amount of transitions out of a single state, child() uses a
+// binary search instead of a linear one.
+static const size_t LinearEdges = 8;
+
+// Bytes read from an InputStream at a time.
+static const size_t StreamChunk = 4096;
+
+/**
+ * Runs the automaton over a text, one UTF-16 unit at a time, collecting the
+ * matches. The arrays of the matcher are accessed through plain pointers,
+ * as this is the inner loop.
+ */
+class StringMatcher::Scanner {
+public:
+    Scanner(const StringMatcher& m, bool all) : matcher(m), all(all),
+            state(Root), position(0), found(false),
+            length(m._patternLength.carray()), same(m._samePattern.carray()),
+            output(m._output.carray()), dictionary(m._dictionary.carray()),
+            rootTable(m._rootTable.carray()) {}
+
+    // Feeds len units; returns false once done (only if not all matches are
+    // needed).
+    bool feed(const uchar * text, size_t len) {
+        for (idx_t i = 0; i < len; ++i) {
+            uchar c = text[i];
+            state = state == Root && c < 256 ? rootTable[c] :
+                    matcher.step(state, c);
+            ++position;
+            uint32_t hit = output[state] != None ? state : dictionary[state];
+            if (hit == None) continue;
+            found = true;
+            if (!all) return false;
+            report(hit);
+        }
+        return true;
+    }
+
+    Array<Match> result() const {
+        return matches.toArray();
+    }
+
+    bool anyFound() const {
+        return found;
+    }
+
+private:
+    void report(uint32_t hit) {
+        for (; hit != None; hit = dictionary[hit]) {
+            for (uint32_t p = output[hit]; p != None; p = same[p]) {
+                Match m = { p, position - length[p] };
+                matches.add(m);
+            }
+        }
+    }
+
+    const StringMatcher& matcher;
+    bool all;
+    uint32_t state;
+    idx_t position;
+    bool found;
+    Vector<Match> matches;
+    const uint32_t * length;
+    const uint32_t * same;
+    const uint32_t * output;
+    const uint32_t * dictionary;
+    const uint32_t * rootTable;
+};
+
+StringMatcher::StringMatcher(const Array<String> patterns) :
+        _patterns(patterns), _patternLength((size_t)patterns.length),
+        _samePattern((size_t)patterns.length), _rootTable((size_t)256) {
+    // Build the trie. While building, the transitions out of a state form a
+    // linked list through firstChild and sibling.
+    Vector<uchar> unit;
+    Vector<uint32_t> firstChild;
+    Vector<uint32_t> sibling;
+    Vector<uint32_t> output;
+    unit.add(0);
+    firstChild.add(None);
+    sibling.add(None);
+    output.add(None);
+
+    for (idx_t p = 0; p < patterns.length; ++p) {
+        const String pattern = patterns[p];
+        _patternLength[p] = pattern.length();
+        _samePattern[p] = None;
+        if (pattern.length() == 0) continue;
+
+        const uchar * str = pattern.rawdata();
+        uint32_t state = Root;
+        for (idx_t i = 0; i < pattern.length(); ++i) {
+            uint32_t next = firstChild[state];
+            while (next != None && unit[next] != str[i]) next = sibling[next];
+            if (next == None) {
+                next = unit.size();
+                unit.add(str[i]);
+                firstChild.add(None);
+                sibling.add(firstChild[state]);
+                output.add(None);
+                firstChild[state] = next;
+            }
+            state = next;
+        }
+        // Duplicates are chained, keeping the patterns in order.
+        if (output[state] == None) {
+            output[state] = p;
+        } else {
+            uint32_t last = output[state];
+            while (_samePattern[last] != None) last = _samePattern[last];
+            _samePattern[last] = p;
+        }
+    }
+
+    size_t states = unit.size();
+    _output = output.toArray();
+    _fail = Array<uint32_t>(states);
+    _dictionary = Array<uint32_t>(states);
+    _edgeStart = Array<uint32_t>(states + 1);
+    _edgeUnit = Array<uchar>(states - 1);
+    _edgeTarget = Array<uint32_t>(states - 1);
+
+    // Lay out the transitions of each state consecutively, sorted by unit.
+    uint32_t edge = 0;
+    for (idx_t s = 0; s < states; ++s) {
+        _edgeStart[s] = edge;
+        for (uint32_t c = firstChild[s]; c != None; c = sibling[c]) {
+            idx_t i = edge++;
+            while (i > _edgeStart[s] && _edgeUnit[i - 1] > unit[c]) {
+                _edgeUnit[i] = _edgeUnit[i - 1];
+                _edgeTarget[i] = _edgeTarget[i - 1];
+                --i;
+            }
+            _edgeUnit[i] = unit[c];
+            _edgeTarget[i] = c;
+        }
+    }
+    _edgeStart[states] = edge;
+
+    // Compute the failure transitions in breadth-first order, so that the
+    // failure transition of a state's parent is always known.
+    Array<uint32_t> queue(states);
+    size_t head = 0;
+    size_t tail = 0;
+    _fail[Root] = Root;
+    _dictionary[Root] = None;
+    for (idx_t e = _edgeStart[Root]; e < _edgeStart[Root + 1]; ++e) {
+        uint32_t s = _edgeTarget[e];
+        _fail[s] = Root;
+        _dictionary[s] = None;
+        queue[tail++] = s;
+    }
+    while (head < tail) {
+        uint32_t parent = queue[head++];
+        for (idx_t e = _edgeStart[parent]; e < _edgeStart[parent + 1]; ++e) {
+            uint32_t s = _edgeTarget[e];
+            uint32_t f = step(_fail[parent], _edgeUnit[e]);
+            _fail[s] = f;
+            _dictionary[s] = _output[f] != None ? f : _dictionary[f];
+            queue[tail++] = s;
+        }
+    }
+
+    for (idx_t c = 0; c < 256; ++c) {
+        uint32_t s = child(Root, c);
+        _rootTable[c] = s == None ? Root : s;
+    }
+}
+
+uint32_t StringMatcher::child(uint32_t state, uchar c) const {
+    const uchar * units = _edgeUnit.carray();
+    idx_t lo = _edgeStart.carray()[state];
+    idx_t hi = _edgeStart.carray()[state + 1];
+    if (hi - lo > LinearEdges) {
+        while (lo < hi) {
+            idx_t mid = lo + (hi - lo) / 2;
+            if (units[mid] < c) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < _edgeStart.carray()[state + 1] && units[lo] == c ?
+                _edgeTarget.carray()[lo] : None;
+    }
+    for (; lo < hi; ++lo) {
+        if (units[lo] == c) return _edgeTarget.carray()[lo];
+    }
+    return None;
+}
+
+uint32_t StringMatcher::step(uint32_t state, uchar c) const {
+    for (;;) {
+        uint32_t next = child(state, c);
+        if (next != None) return next;
+        if (state == Root) return Root;
+        state = _fail.carray()[state];
+    }
+}
+
+Array<StringMatcher::Match> StringMatcher::matchesIn(const String text) const {
+    Scanner scanner(*this, true);
+    scanner.feed(text.rawdata(), text.length());
+    return scanner.result();
+}
+
+Array<StringMatcher::Match> StringMatcher::matchesIn(
+        const Array<uchar> text) const {
+    Scanner scanner(*this, true);
+    scanner.feed(text.carray(), text.length);
+    return scanner.result();
+}
+
+// Returns the amount of bytes at the end of buf that form the start of a
+// UTF-8 sequence which continues in the next chunk.
+static size_t incompleteTail(const byte * buf, size_t len) {
+    for (size_t k = 1; k <= 3 && k <= len; ++k) {
+        byte c = buf[len - k];
+        if ((c & 0xC0) == 0x80) continue;
+        size_t width = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 :
+                (c & 0xF8) == 0xF0 ? 4 : 1;
+        return width > k ? k : 0;
+    }
+    return 0;
+}
+
+Array<StringMatcher::Match> StringMatcher::matchesIn(InputStream& in) const {
+    Scanner scanner(*this, true);
+    // Not every stream honours the offset argument of read(), so chunks are
+    // always read whole, and appended to the bytes left over from the last
+    // chunk in a separate buffer.
+    Array<byte> chunk((size_t)StreamChunk);
+    byte work[StreamChunk + 3];
+    size_t carry = 0;
+    while (!in.eof()) {
+        fssize_t read = in.read(chunk);
+        if (read <= 0) break;
+        carraycopy(chunk.carray(), 0, work, carry, read);
+        size_t len = carry + read;
+        carry = incompleteTail(work, len);
+        String decoded;
+        decoded.fromUtf8(reinterpret_cast<const char*>(work), len - carry);
+        scanner.feed(decoded.rawdata(), decoded.length());
+        carraycopy(work, len - carry, work, 0, carry);
+    }
+    if (carry > 0) {
+        // a truncated sequence at the very end
+        String decoded;
+        decoded.fromUtf8(reinterpret_cast<const char*>(work), carry);
+        scanner.feed(decoded.rawdata(), decoded.length());
+    }
+    return scanner.result();
+}
+
+bool StringMatcher::foundIn(const String text) const {
+    Scanner scanner(*this, false);
+    scanner.feed(text.rawdata(), text.length());
+    return scanner.anyFound();
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,146 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_STRINGMATCHER_H_
+#define SYLPH_CORE_STRINGMATCHER_H_
+
+#include "Object.h"
+#include "Array.h"
+#include "Primitives.h"
+#include "String.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+class InputStream;
+
+/**
+ * Finds any number of patterns in a text in a single pass. StringMatcher
+ * compiles a set of patterns into an Aho-Corasick automaton, after which
+ * the time needed to scan a text only depends on the length of the text and
+ * the amount of matches, not on the amount of patterns. Looking for dozens
+ * of keywords is thus much cheaper than calling String::contains() for each
+ * of them.
+ *
+ * Matching is done on UTF-16 units, exactly like String::indexOf(). A
+ * StringMatcher is immutable once constructed and can be shared freely.
+ * Empty patterns never match.
+ */
+class StringMatcher : public virtual Object {
+public:
+    /**
+     * A single occurrence of a pattern.
+     */
+    struct Match {
+        /** The index of the pattern that was found. */
+        idx_t pattern;
+        /** The index of the first character of the occurrence. */
+        idx_t offset;
+    };
+
+    /**
+     * Compiles a new matcher for the given patterns.
+     * @param patterns The patterns to look for. Each Match refers to one of
+     * these by its index in this array.
+     */
+    explicit StringMatcher(const Array<String> patterns);
+
+    /**
+     * Returns the patterns this matcher looks for.
+     * @return The patterns this matcher was created with.
+     */
+    const Array<String> patterns() const {
+        return _patterns;
+    }
+
+    /**
+     * Finds all occurrences of all patterns in the given String. Overlapping
+     * occurrences are all reported. The matches are ordered by the position
+     * of their last character; matches ending at the same position are
+     * ordered from longest to shortest.
+     * @param text The String to search in.
+     * @return All occurrences of the patterns in the text.
+     */
+    Array<Match> matchesIn(const String text) const;
+
+    /**
+     * Finds all occurrences of all patterns in the given array of UTF-16
+     * units. This behaves exactly like matchesIn(const String).
+     * @param text The characters to search in.
+     * @return All occurrences of the patterns in the text.
+     */
+    Array<Match> matchesIn(const Array<uchar> text) const;
+
+    /**
+     * Finds all occurrences of all patterns in the given stream, which is read
+     * until its end. The stream is decoded as UTF-8 in the same way as
+     * String(const char*) does, and the offsets in the returned matches are
+     * counted in UTF-16 units from the position the stream was in when this
+     * method was called. Only the matches are kept in memory, never the
+     * entire stream.
+     * @param in The stream to search in.
+     * @return All occurrences of the patterns in the stream.
+     */
+    Array<Match> matchesIn(InputStream& in) const;
+
+    /**
+     * Checks whether any of the patterns occurs in the given String. This
+     * stops at the first occurrence.
+     * @param text The String to search in.
+     * @return true if at least one pattern occurs in the text.
+     */
+    bool foundIn(const String text) const;
+
+private:
+    class Scanner;
+
+    uint32_t child(uint32_t state, uchar c) const;
+    uint32_t step(uint32_t state, uchar c) const;
+
+    Array<String> _patterns;
+    // Per pattern: its length, and the next pattern that ends in the same
+    // state (only set for duplicate patterns).
+    Array<uint32_t> _patternLength;
+    Array<uint32_t> _samePattern;
+    // Per state: the first pattern that ends in it, the failure transition,
+    // and the nearest state along the failure transitions that completes a
+    // pattern.
+    Array<uint32_t> _output;
+    Array<uint32_t> _fail;
+    Array<uint32_t> _dictionary;
+    // The transitions out of state s are _edgeUnit[_edgeStart[s]] up to
+    // _edgeUnit[_edgeStart[s+1]], sorted, with their targets in _edgeTarget.
+    Array<uint32_t> _edgeStart;
+    Array<uchar> _edgeUnit;
+    Array<uint32_t> _edgeTarget;
+    // All transitions out of the start state for the units below 256, which
+    // is where a scan of typical text spends most of its time.
+    Array<uint32_t> _rootTable;
+};
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_STRINGMATCHER_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,93 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+#include "StringPool.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+#define POOL_LOCK() std::lock_guard<std::mutex> guard(_lock)
+#else
+#define POOL_LOCK()
+#endif
+
+static const size_t InitialCapacity = 64;
+
+StringPool::StringPool() : _slots(InitialCapacity), _size(0) {
+}
+
+String StringPool::intern(const String s) {
+    if (s.length() <= String::SmallCapacity) return s;
+
+    // The hash is cached in the String, so it is only ever computed once.
+    size_t h = uint32_t(Hash<String>()(s));
+    POOL_LOCK();
+    size_t mask = _slots.length - 1;
+    for (size_t i = h & mask; ; i = (i + 1) & mask) {
+        const String& slot = _slots[i];
+        if (slot.empty()) break;
+        if (slot == s) return slot;
+    }
+
+    // Keep the table at most half full.
+    if (2 * (_size + 1) > _slots.length) grow();
+    mask = _slots.length - 1;
+    size_t i = h & mask;
+    while (!_slots[i].empty()) i = (i + 1) & mask;
+    _slots[i] = s;
+    ++_size;
+    return s;
+}
+
+size_t StringPool::size() const {
+    POOL_LOCK();
+    return _size;
+}
+
+void StringPool::clear() {
+    POOL_LOCK();
+    _slots = Array<String>(InitialCapacity);
+    _size = 0;
+}
+
+StringPool& StringPool::global() {
+    static StringPool pool;
+    return pool;
+}
+
+void StringPool::grow() {
+    Array<String> old = _slots;
+    _slots = Array<String>(old.length * 2);
+    size_t mask = _slots.length - 1;
+    for (size_t j = 0; j < old.length; ++j) {
+        if (old[j].empty()) continue;
+        size_t i = uint32_t(Hash<String>()(old[j])) & mask;
+        while (!_slots[i].empty()) i = (i + 1) & mask;
+        _slots[i] = old[j];
+    }
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,106 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+#ifndef SYLPH_CORE_STRINGPOOL_H_
+#define SYLPH_CORE_STRINGPOOL_H_
+
+#include "Object.h"
+#include "Array.h"
+#include "Primitives.h"
+#include "String.h"
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+#include <mutex>
+#endif
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A set of canonical Strings. Interning a String returns the one String in
+ * the pool with the same contents, adding it first if there is none yet.
+ * All Strings interned from equal contents therefore share a single copy of
+ * their data, which saves memory when the same keys are created over and
+ * over, e.g. when reading many similar records. Interned Strings also
+ * compare equal in constant time, since operator==() first checks whether
+ * both sides share their data.
+ *
+ * Strings short enough to be stored inline take no memory of their own, so
+ * they are returned as they are and never added to the pool.
+ *
+ * The pool keeps the Strings in it alive until it is cleared. The global
+ * pool used by String::intern() is never cleared on its own. If LibSylph
+ * is built with @c SYLPH_ATOMIC_REFCOUNT, a StringPool can be shared
+ * between threads; otherwise it cannot.
+ */
+class StringPool : public virtual Object {
+public:
+    /**
+     * Creates a new, empty pool.
+     */
+    StringPool();
+
+    /**
+     * Returns the canonical String with the same contents as the given one.
+     * @param s The String to intern.
+     * @return A String equal to @c s that shares its data with every other
+     * String interned from equal contents.
+     */
+    String intern(const String s);
+
+    /**
+     * Returns the amount of Strings in the pool.
+     * @return The amount of distinct Strings interned since the pool was
+     * created or last cleared.
+     */
+    size_t size() const;
+
+    /**
+     * Removes all Strings from the pool. Strings interned earlier remain
+     * valid, but will not share data with Strings interned afterwards.
+     */
+    void clear();
+
+    /**
+     * Returns the pool used by String::intern().
+     * @return The global StringPool.
+     */
+    static StringPool& global();
+
+private:
+    void grow();
+
+    // Open addressing with linear probing; empty slots hold empty Strings.
+    // The capacity is always a power of two.
+    Array<String> _slots;
+    size_t _size;
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    mutable std::mutex _lock;
+#endif
+};
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_STRINGPOOL_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
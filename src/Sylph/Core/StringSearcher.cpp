@@ -0,0 +1,225 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "StringSearcher.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+SYLPH_BEGIN_NAMESPACE
+
+// Needles up to this length are found with the first/last character filter,
+// longer ones with Horspool. Below this the skips Horspool can make are too
+// short to beat testing 8 positions at once.
+static const size_t ShortNeedle = 16;
+
+static inline bool equalUnits(const uchar * a, const uchar * b, size_t len) {
+    return std::memcmp(a, b, len * sizeof(uchar)) == 0;
+}
+
+StringSearcher::StringSearcher(const String needle) : _needle(needle) {
+    const uchar * ndl = _needle.rawdata();
+    size_t m = _needle.length();
+    if (m <= ShortNeedle) return;
+
+    for (idx_t c = 0; c < 256; ++c) {
+        _forwardSkip[c] = m;
+        _backwardSkip[c] = m;
+    }
+    // Later (resp. earlier) occurrences overwrite the entry, so each entry
+    // ends up with the smallest safe skip.
+    for (idx_t j = 0; j < m - 1; ++j) {
+        _forwardSkip[ndl[j] & 0xFF] = m - 1 - j;
+    }
+    for (idx_t j = m - 1; j > 0; --j) {
+        _backwardSkip[ndl[j] & 0xFF] = j;
+    }
+}
+
+sidx_t StringSearcher::indexIn(const String haystack, idx_t start) const {
+    return indexIn(StringView(haystack), start);
+}
+
+sidx_t StringSearcher::lastIndexIn(const String haystack) const {
+    return lastIndexIn(StringView(haystack));
+}
+
+sidx_t StringSearcher::lastIndexIn(const String haystack, idx_t end) const {
+    return lastIndexIn(StringView(haystack), end);
+}
+
+sidx_t StringSearcher::indexIn(const StringView haystack, idx_t start) const {
+    size_t len = haystack.length();
+    if (start > len) return -1;
+    if (_needle.length() == 0) return start;
+    return forward(haystack.data(), len, start);
+}
+
+sidx_t StringSearcher::lastIndexIn(const StringView haystack) const {
+    size_t len = haystack.length();
+    if (_needle.length() == 0) return len;
+    return backward(haystack.data(), len);
+}
+
+sidx_t StringSearcher::lastIndexIn(const StringView haystack,
+        idx_t end) const {
+    size_t len = haystack.length();
+    if (end < len) len = end + 1;
+    if (_needle.length() == 0) return len;
+    return backward(haystack.data(), len);
+}
+
+sidx_t StringSearcher::forward(const uchar * hay, size_t len,
+        size_t start) const {
+    const uchar * ndl = _needle.rawdata();
+    size_t m = _needle.length();
+    if (len - start < m) return -1;
+    // The last position at which an occurrence can begin.
+    size_t last = len - m;
+    size_t i = start;
+
+    if (m == 1) {
+#ifdef __SSE2__
+        const __m128i vc = _mm_set1_epi16(short(ndl[0]));
+        for (; i + 8 <= len; i += 8) {
+            __m128i v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(hay + i));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v, vc));
+            if (mask != 0) return i + (__builtin_ctz(mask) >> 1);
+        }
+#endif
+        for (; i < len; ++i) {
+            if (hay[i] == ndl[0]) return i;
+        }
+        return -1;
+    }
+
+    if (m <= ShortNeedle) {
+        const uchar first = ndl[0];
+        const uchar lastc = ndl[m - 1];
+#ifdef __SSE2__
+        // Test 8 candidate positions at once for both their first and their
+        // last character, and only compare the middle for those that match.
+        const __m128i vf = _mm_set1_epi16(short(first));
+        const __m128i vl = _mm_set1_epi16(short(lastc));
+        for (; i + 8 <= last + 1; i += 8) {
+            __m128i a = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(hay + i));
+            __m128i b = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(hay + i + m - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi16(a, vf), _mm_cmpeq_epi16(b, vl)));
+            while (mask != 0) {
+                unsigned bit = __builtin_ctz(mask);
+                size_t pos = i + (bit >> 1);
+                if (equalUnits(hay + pos + 1, ndl + 1, m - 2)) return pos;
+                mask &= ~(3u << bit);
+            }
+        }
+#endif
+        for (; i <= last; ++i) {
+            if (hay[i] == first && hay[i + m - 1] == lastc &&
+                    equalUnits(hay + i + 1, ndl + 1, m - 2)) return i;
+        }
+        return -1;
+    }
+
+    const uchar lastc = ndl[m - 1];
+    while (i <= last) {
+        uchar c = hay[i + m - 1];
+        if (c == lastc && equalUnits(hay + i, ndl, m - 1)) return i;
+        i += _forwardSkip[c & 0xFF];
+    }
+    return -1;
+}
+
+sidx_t StringSearcher::backward(const uchar * hay, size_t len) const {
+    const uchar * ndl = _needle.rawdata();
+    size_t m = _needle.length();
+    if (len < m) return -1;
+    // The candidate position, moving towards the front.
+    sidx_t i = len - m;
+
+    if (m == 1) {
+#ifdef __SSE2__
+        const __m128i vc = _mm_set1_epi16(short(ndl[0]));
+        for (; i >= 7; i -= 8) {
+            __m128i v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(hay + i - 7));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v, vc));
+            if (mask != 0) return i - 7 + ((31 - __builtin_clz(mask)) >> 1);
+        }
+#endif
+        for (; i >= 0; --i) {
+            if (hay[i] == ndl[0]) return i;
+        }
+        return -1;
+    }
+
+    if (m <= ShortNeedle) {
+        const uchar first = ndl[0];
+        const uchar lastc = ndl[m - 1];
+#ifdef __SSE2__
+        const __m128i vf = _mm_set1_epi16(short(first));
+        const __m128i vl = _mm_set1_epi16(short(lastc));
+        for (; i >= 7; i -= 8) {
+            const uchar * base = hay + i - 7;
+            __m128i a = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(base));
+            __m128i b = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(base + m - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi16(a, vf), _mm_cmpeq_epi16(b, vl)));
+            while (mask != 0) {
+                unsigned bit = (31 - __builtin_clz(mask)) & ~1u;
+                const uchar * pos = base + (bit >> 1);
+                if (equalUnits(pos + 1, ndl + 1, m - 2)) return pos - hay;
+                mask &= ~(3u << bit);
+            }
+        }
+#endif
+        for (; i >= 0; --i) {
+            if (hay[i] == first && hay[i + m - 1] == lastc &&
+                    equalUnits(hay + i + 1, ndl + 1, m - 2)) return i;
+        }
+        return -1;
+    }
+
+    const uchar first = ndl[0];
+    for (;;) {
+        uchar c = hay[i];
+        if (c == first && equalUnits(hay + i + 1, ndl + 1, m - 1)) return i;
+        sidx_t skip = _backwardSkip[c & 0xFF];
+        if (i < skip) return -1;
+        i -= skip;
+    }
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
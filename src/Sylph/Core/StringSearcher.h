@@ -0,0 +1,140 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_STRINGSEARCHER_H_
+#define SYLPH_CORE_STRINGSEARCHER_H_
+
+#include "Object.h"
+#include "Primitives.h"
+#include "String.h"
+#include "StringView.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A precompiled substring search. StringSearcher analyses a needle once and
+ * can then look for it in any number of haystacks, which is cheaper than
+ * calling String::indexOf() repeatedly with the same needle.
+ *
+ * Short needles are found by scanning for their first and last character
+ * together, several UTF-16 units at a time when SSE2 is available. Longer
+ * needles use Boyer-Moore-Horspool, which skips up to the length of the
+ * needle at a time and thus runs in sub-linear time on typical input.
+ * A StringSearcher is immutable once constructed and can be shared freely.
+ *
+ * String::indexOf(), String::lastIndexOf() and String::contains() are
+ * implemented in terms of this class.
+ */
+class StringSearcher : public virtual Object {
+public:
+    /**
+     * Creates a new searcher for the given needle.
+     * @param needle The String to look for.
+     */
+    explicit StringSearcher(const String needle);
+
+    /**
+     * Returns the needle this searcher looks for.
+     * @return The needle this searcher was created with.
+     */
+    const String needle() const {
+        return _needle;
+    }
+
+    /**
+     * Finds the first occurrence of the needle in the given String,
+     * starting at given index.
+     * @param haystack The String to search in.
+     * @param start The first index at which an occurrence may begin.
+     * @return The index of the first character of the first occurrence, or
+     * -1 if the needle does not occur. An empty needle is found at
+     * @c start, as long as @c start does not lie beyond the end of the
+     * haystack.
+     */
+    sidx_t indexIn(const String haystack, idx_t start = 0) const;
+
+    /**
+     * Finds the last occurrence of the needle in the given String.
+     * @param haystack The String to search in.
+     * @return The index of the first character of the last occurrence, or -1
+     * if the needle does not occur.
+     */
+    sidx_t lastIndexIn(const String haystack) const;
+
+    /**
+     * Finds the last occurrence of the needle in the given String that ends
+     * at or before the given index.
+     * @param haystack The String to search in.
+     * @param end The last index an occurrence may cover.
+     * @return The index of the first character of the last such occurrence,
+     * or -1 if there is none.
+     */
+    sidx_t lastIndexIn(const String haystack, idx_t end) const;
+
+    /**
+     * Finds the first occurrence of the needle in the given view.
+     * @see indexIn(const String, idx_t)
+     */
+    sidx_t indexIn(const StringView haystack, idx_t start = 0) const;
+
+    /**
+     * Finds the last occurrence of the needle in the given view.
+     * @see lastIndexIn(const String)
+     */
+    sidx_t lastIndexIn(const StringView haystack) const;
+
+    /**
+     * Finds the last occurrence of the needle in the given view that ends at
+     * or before the given index.
+     * @see lastIndexIn(const String, idx_t)
+     */
+    sidx_t lastIndexIn(const StringView haystack, idx_t end) const;
+
+    /**
+     * Checks whether the needle occurs in the given String.
+     * @param haystack The String to search in.
+     * @return true if the needle occurs at least once, false otherwise.
+     */
+    bool foundIn(const String haystack) const {
+        return indexIn(haystack) != -1;
+    }
+
+private:
+    sidx_t forward(const uchar* hay, size_t len, size_t start) const;
+    sidx_t backward(const uchar* hay, size_t len) const;
+
+    String _needle;
+    // Horspool skip tables, indexed by the low byte of a UTF-16 unit. Units
+    // sharing a low byte share an entry, which holds the smallest skip of
+    // all of them, so a collision only ever costs some speed.
+    size_t _forwardSkip[256];
+    size_t _backwardSkip[256];
+};
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_STRINGSEARCHER_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,126 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "StringTokenizer.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+StringTokenizer::StringTokenizer(const String text,
+        const Array<uchar> delimiters) : _text(text) {
+    setDelimiters(delimiters);
+}
+
+StringTokenizer::StringTokenizer(const StringView text,
+        const Array<uchar> delimiters) : _text(text) {
+    setDelimiters(delimiters);
+}
+
+void StringTokenizer::setDelimiters(const Array<uchar> delimiters) {
+    _low[0] = _low[1] = _low[2] = _low[3] = 0;
+    size_t high = 0;
+    for (idx_t i = 0; i < delimiters.length; ++i) {
+        uchar c = delimiters[i];
+        if (c < 256) _low[c >> 6] |= uint64_t(1) << (c & 63);
+        else ++high;
+    }
+    if (high == 0) return;
+
+    _high = Array<uchar>(high);
+    high = 0;
+    for (idx_t i = 0; i < delimiters.length; ++i) {
+        if (delimiters[i] >= 256) _high[high++] = delimiters[i];
+    }
+}
+
+idx_t StringTokenizer::skip(idx_t from, bool delimiter) const {
+    const uchar * str = _text.data();
+    size_t len = _text.length();
+    while (from < len && isDelimiter(str[from]) == delimiter) ++from;
+    return from;
+}
+
+size_t StringTokenizer::countTokens() const {
+    size_t count = 0;
+    idx_t pos = skip(0, true);
+    while (pos < _text.length()) {
+        ++count;
+        pos = skip(skip(pos, false), true);
+    }
+    return count;
+}
+
+TokenIterator::TokenIterator(bool begin, const StringTokenizer* tok) :
+        super(begin), _tok(tok), _start(0), _end(0), _nextStart(0) {
+    if (!_tok) {
+        super::_end_reached_ = true;
+        return;
+    }
+    size_t len = _tok->_text.length();
+    if (_tok->skip(0, true) == len) {
+        // no tokens at all, begin() == end()
+        super::_end_reached_ = true;
+        _start = _end = _nextStart = len;
+    } else if (begin) {
+        _nextStart = _tok->skip(0, true);
+        next();
+    } else {
+        // end() points at the last token
+        const uchar * str = _tok->_text.data();
+        _end = len;
+        while (_tok->isDelimiter(str[_end - 1])) --_end;
+        _start = _end;
+        while (_start > 0 && !_tok->isDelimiter(str[_start - 1])) --_start;
+        _nextStart = len;
+    }
+}
+
+TokenIterator::TokenIterator(const TokenIterator& other) : super(other),
+        _tok(other._tok), _start(other._start), _end(other._end),
+        _nextStart(other._nextStart) {
+}
+
+bool TokenIterator::equals(const TokenIterator& other) const {
+    return _tok == other._tok && _start == other._start;
+}
+
+const StringView& TokenIterator::current() const {
+    const StringView& text = _tok->_text;
+    _current = StringView(text._str, text._offset + _start, _end - _start);
+    return _current;
+}
+
+bool TokenIterator::hasNext() const {
+    return _nextStart < _tok->_text.length();
+}
+
+void TokenIterator::next() {
+    _start = _nextStart;
+    _end = _tok->skip(_start, false);
+    _nextStart = _tok->skip(_end, true);
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,150 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_STRINGTOKENIZER_H_
+#define SYLPH_CORE_STRINGTOKENIZER_H_
+
+#include "Object.h"
+#include "Array.h"
+#include "Iterator.h"
+#include "Primitives.h"
+#include "String.h"
+#include "StringView.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+class StringTokenizer;
+
+/**
+ * Iterates over the tokens of a StringTokenizer. Tokens are only looked up
+ * when the iterator is advanced.
+ */
+class TokenIterator :
+        public ForwardIterator<const StringView, TokenIterator> {
+public:
+    typedef ForwardIterator<const StringView, TokenIterator> super;
+
+    TokenIterator(bool begin = false, const StringTokenizer* tok = null);
+    TokenIterator(const TokenIterator& other);
+
+    bool equals(const TokenIterator& other) const;
+    const StringView& current() const;
+    bool hasNext() const;
+    void next();
+
+private:
+    const StringTokenizer* _tok;
+    idx_t _start;
+    idx_t _end;
+    idx_t _nextStart;
+    mutable StringView _current;
+};
+
+/**
+ * Splits a String into tokens, lazily. The tokens are separated by any of a
+ * given set of delimiter characters; empty tokens are skipped, exactly like
+ * String::split() does. Unlike String::split(), the tokens are only found
+ * as they are iterated over, and are returned as StringViews on the
+ * original String, so tokenizing does not allocate any memory.
+ * <pre>for (const StringView& word : StringTokenizer(line)) { ... }</pre>
+ * Delimiters below U+0100 are looked up in a bitset, so the amount of
+ * delimiters does not influence the speed of tokenizing.
+ */
+class StringTokenizer : public virtual Object {
+    friend class TokenIterator;
+
+public:
+    typedef TokenIterator iterator;
+    typedef TokenIterator const_iterator;
+
+    /**
+     * Creates a tokenizer over the given String.
+     * @param text The String to tokenize.
+     * @param delimiters The characters that separate the tokens, by default
+     * equal to @c spacechars.
+     */
+    explicit StringTokenizer(const String text,
+            const Array<uchar> delimiters = spacechars);
+
+    /**
+     * Creates a tokenizer over the given view.
+     * @param text The characters to tokenize.
+     * @param delimiters The characters that separate the tokens, by default
+     * equal to @c spacechars.
+     */
+    explicit StringTokenizer(const StringView text,
+            const Array<uchar> delimiters = spacechars);
+
+    /**
+     * Returns an iterator to the first token.
+     */
+    iterator begin() const {
+        return iterator(true, this);
+    }
+
+    /**
+     * Returns an iterator past the last token.
+     */
+    iterator end() const {
+        return iterator(false, this);
+    }
+
+    /**
+     * Checks whether given character is one of the delimiters.
+     * @param c A character.
+     * @return true if @c c separates tokens, false otherwise.
+     */
+    bool isDelimiter(uchar c) const {
+        if (c < 256) return (_low[c >> 6] >> (c & 63)) & 1;
+        for (idx_t i = 0; i < _high.length; ++i) {
+            if (_high[i] == c) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Counts the tokens. This scans the entire String, but does not create
+     * any tokens.
+     * @return The amount of tokens.
+     */
+    size_t countTokens() const;
+
+private:
+    void setDelimiters(const Array<uchar> delimiters);
+
+    // Returns the index of the first character at or after @c from that is
+    // (or is not) a delimiter, or the length of the text if there is none.
+    idx_t skip(idx_t from, bool delimiter) const;
+
+    StringView _text;
+    uint64_t _low[4];
+    Array<uchar> _high;
+};
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_STRINGTOKENIZER_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
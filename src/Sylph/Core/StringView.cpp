@@ -0,0 +1,131 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "StringView.h"
+#include "Range.h"
+#include "StringSearcher.h"
+
+#include <cstring>
+
+SYLPH_BEGIN_NAMESPACE
+
+// The characters in spacechars.
+static inline bool isSpace(uchar c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+uchar StringView::at(sidx_t idx) const {
+#if SYLPH_CHECKED_ARRAYS
+    // a negative index wraps around to a huge one
+    if (size_t(idx) < _length) return data()[idx];
+    if (idx < 0 && size_t(-idx) <= _length) return data()[_length + idx];
+    throwArrayOverflow(idx, _length, "StringView");
+#else
+    return data()[idx >= 0 ? idx : _length + idx];
+#endif
+}
+
+StringView StringView::slice(idx_t begin) const throw(ArrayException) {
+    return slice(begin, _length - 1);
+}
+
+StringView StringView::slice(idx_t begin, idx_t end) const
+        throw(ArrayException) {
+    // Same semantics as Array::operator[](range&&)
+    range ran(begin, end);
+    ran.last = ran.last < 0 ? _length + ran.last : ran.last;
+    ran.first = ran.first < 0 ? _length + ran.first : ran.first;
+    if(ran.inverse()) sthrow(ArrayException, "Inverted range");
+
+    if (ran.first < 0) throwArrayOverflow(ran.first, _length, "StringView");
+    if ((unsigned)ran.last >= _length) {
+        throwArrayOverflow(ran.last, _length, "StringView");
+    }
+
+    return StringView(_str, _offset + ran.first, (ran.last - ran.first) + 1);
+}
+
+StringView StringView::trim() const {
+    const uchar * str = data();
+    idx_t begin = 0;
+    idx_t end = _length;
+    while (begin < end && isSpace(str[begin])) ++begin;
+    while (end > begin && isSpace(str[end - 1])) --end;
+    return StringView(_str, _offset + begin, end - begin);
+}
+
+sidx_t StringView::indexOf(const String substr, idx_t start) const {
+    return StringSearcher(substr).indexIn(*this, start);
+}
+
+sidx_t StringView::lastIndexOf(const String substr) const {
+    return StringSearcher(substr).lastIndexIn(*this);
+}
+
+bool StringView::startsWith(const String other) const {
+    size_t len = other.length();
+    return len <= _length &&
+            std::memcmp(data(), other.rawdata(), len * sizeof(uchar)) == 0;
+}
+
+bool StringView::endsWith(const String other) const {
+    size_t len = other.length();
+    return len <= _length && std::memcmp(data() + _length - len,
+            other.rawdata(), len * sizeof(uchar)) == 0;
+}
+
+bool StringView::contains(const String other) const {
+    return StringSearcher(other).indexIn(*this) != -1;
+}
+
+String StringView::toString() const {
+    if (_offset == 0 && _length == _str.length()) return _str;
+    return String(data(), _length);
+}
+
+const uchar * StringView::data() const {
+    return _str.rawdata() + _offset;
+}
+
+bool operator==(const StringView lhs, const StringView rhs) {
+    return lhs.length() == rhs.length() && std::memcmp(lhs.data(),
+            rhs.data(), lhs.length() * sizeof(uchar)) == 0;
+}
+
+bool operator==(const StringView lhs, const String rhs) {
+    return lhs == StringView(rhs);
+}
+
+bool operator==(const String lhs, const StringView rhs) {
+    return StringView(lhs) == rhs;
+}
+
+std::ostream& operator<<(std::ostream& lhs, const StringView rhs) {
+    return lhs << rhs.toString();
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,224 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_STRINGVIEW_H_
+#define SYLPH_CORE_STRINGVIEW_H_
+
+#include "Object.h"
+#include "Exception.h"
+#include "Primitives.h"
+#include "String.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A view on a part of a String. A StringView refers to a range of characters
+ * in the String it was created from, sharing that String's data instead of
+ * copying it. This makes taking views O(1) regardless of their length, which
+ * helps when a String is cut into many pieces, e.g. when parsing.<p>
+ * A StringView keeps the entire String it views alive. When only a small part
+ * of a large String is needed for a long time, convert the view to a String,
+ * which copies only the characters in the view. StringViews convert to
+ * Strings implicitly wherever a String is expected.<p>
+ * Like Strings, StringViews are immutable. Views are created through
+ * String::slice(), or from an entire String through the implicit
+ * constructor.
+ */
+class StringView : public virtual Object {
+    friend class FormatArg;
+    friend class Regex;
+    friend class Rope;
+    friend class String;
+    friend class StringSearcher;
+    friend class StringTokenizer;
+    friend class TokenIterator;
+    friend bool operator==(const StringView lhs, const StringView rhs);
+
+public:
+    /**
+     * Creates an empty view.
+     */
+    StringView() : _offset(0), _length(0) {}
+
+    /**
+     * Creates a view on an entire String.
+     * @param str The String to view.
+     */
+    StringView(const String str) : _str(str), _offset(0),
+            _length(str.length()) {}
+
+    /**
+     * Returns the amount of characters in this view.
+     * @return The length of this view.
+     */
+    size_t length() const {
+        return _length;
+    }
+
+    /**
+     * Returns the character at given index in this view. Negative indices are
+     * counted from the end, just like String::at().
+     * @param idx The index of the character.
+     * @return The character at given index.
+     * @throw ArrayException if the index lies outside of this view, unless
+     * the library was built with @c SYLPH_UNCHECKED_ARRAYS
+     */
+    uchar at(sidx_t idx) const;
+
+    /**
+     * Shorthand for at().
+     */
+    uchar operator[](sidx_t idx) const {
+        return at(idx);
+    }
+
+    /**
+     * Returns a view on the characters from the given index to the end of
+     * this view. This follows the semantics of String::substring(idx_t).
+     * @param begin The first index of the new view.
+     * @return A view on the given range of this view.
+     * @throw ArrayException if <code>begin >= length()</code>.
+     */
+    StringView slice(idx_t begin) const throw(ArrayException);
+
+    /**
+     * Returns a view on the characters from the given begin index up to and
+     * including the given end index. This follows the semantics of
+     * String::substring(idx_t, idx_t).
+     * @param begin The first index of the new view.
+     * @param end The last index of the new view.
+     * @return A view on the given range of this view.
+     * @throw ArrayException if <code>begin >= length() || end >= length() ||
+     * begin > end</code>.
+     */
+    StringView slice(idx_t begin, idx_t end) const throw(ArrayException);
+
+    /**
+     * Returns a view on this view without the whitespace at its front and its
+     * end. Whitespace characters are defined in the array @c spacechars.
+     * @return The trimmed view.
+     */
+    StringView trim() const;
+
+    /**
+     * Returns the first index from given start index in this view on which
+     * the specified substring occurs.
+     * @see String::indexOf()
+     */
+    sidx_t indexOf(const String substr, idx_t start = 0) const;
+
+    /**
+     * Returns the last index in this view on which the specified substring
+     * occurs.
+     * @see String::lastIndexOf()
+     */
+    sidx_t lastIndexOf(const String substr) const;
+
+    /**
+     * Checks if this view starts with the given prefix.
+     * @param other A prefix to test for.
+     * @return Whether this view starts with the given prefix.
+     */
+    bool startsWith(const String other) const;
+
+    /**
+     * Checks if this view ends with the given suffix.
+     * @param other A suffix to test for.
+     * @return Whether this view ends with the given suffix.
+     */
+    bool endsWith(const String other) const;
+
+    /**
+     * Checks if this view contains the given substring.
+     * @param other A substring to test for.
+     * @return Whether this view contains the given substring.
+     */
+    bool contains(const String other) const;
+
+    /**
+     * Copies the characters in this view into a new String. If this view
+     * covers an entire String, that String is returned without copying.
+     * @return A String with the same contents as this view.
+     */
+    String toString() const;
+
+    /**
+     * Converts this view to a String.
+     * @see toString()
+     */
+    operator String() const {
+        return toString();
+    }
+
+private:
+    StringView(const String& str, idx_t offset, size_t length) :
+            _str(str), _offset(offset), _length(length) {}
+
+    const uchar* data() const;
+
+    String _str;
+    idx_t _offset;
+    size_t _length;
+};
+
+bool operator==(const StringView lhs, const StringView rhs);
+bool operator==(const StringView lhs, const String rhs);
+bool operator==(const String lhs, const StringView rhs);
+
+inline bool operator==(const StringView lhs, const char* rhs) {
+    return lhs == String(rhs);
+}
+
+inline bool operator==(const char* lhs, const StringView rhs) {
+    return String(lhs) == rhs;
+}
+
+inline bool operator!=(const StringView lhs, const StringView rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator!=(const StringView lhs, const String rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator!=(const String lhs, const StringView rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator!=(const StringView lhs, const char* rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator!=(const char* lhs, const StringView rhs) {
+    return !(lhs == rhs);
+}
+
+std::ostream& operator<<(std::ostream& lhs, const StringView rhs);
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_STRINGVIEW_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,185 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "Utf8Buffer.h"
+#include "NumberFormat.h"
+#include "Util.h"
+
+#include <cstring>
+#include <utility>
+
+SYLPH_BEGIN_NAMESPACE
+
+Utf8Buffer::Utf8Buffer(const Utf8Buffer& other) : buf(other.buf.copy()),
+        _length(other._length) {
+}
+
+Utf8Buffer::Utf8Buffer(Utf8Buffer&& other) : buf(std::move(other.buf)),
+        _length(other._length) {
+    other._length = 0;
+}
+
+Utf8Buffer::~Utf8Buffer() {
+
+}
+
+Utf8Buffer& Utf8Buffer::operator=(const Utf8Buffer& other) {
+    if (this == &other) return *this;
+    buf = other.buf.copy();
+    _length = other._length;
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator=(Utf8Buffer&& other) {
+    if (this == &other) return *this;
+    buf = std::move(other.buf);
+    _length = other._length;
+    other._length = 0;
+    return *this;
+}
+
+void Utf8Buffer::reserve(size_t capacity) {
+    ensureCapacity(capacity);
+}
+
+Utf8Buffer& Utf8Buffer::append(const char* bytes, size_t len) {
+    ensureCapacity(_length + len);
+    std::memcpy(buf.carray() + _length, bytes, len);
+    _length += len;
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::append(const uchar* units, size_t len) {
+    // No unit takes more than three bytes. Measuring exactly only pays off
+    // for long Strings, where three times the length would waste a lot.
+    ensureCapacity(_length + (len <= 256 ? 3 * len :
+            String::utf8Size(units, len)));
+    _length += String::writeUtf8(units, len,
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(bool b) {
+    return b ? append("true", 4) : append("false", 5);
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    ensureCapacity(_length + 2);
+    if (u < 0x80) {
+        buf.carray()[_length++] = u;
+    } else {
+        buf.carray()[_length++] = 0xC0 | (u >> 6);
+        buf.carray()[_length++] = 0x80 | (u & 0x3F);
+    }
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(const char* s) {
+    return append(s, std::strlen(s));
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(const String& s) {
+    return append(s.rawdata(), s.length());
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(int32_t i) {
+    ensureCapacity(_length + NumberBufferSize);
+    _length += formatInteger(int64_t(i),
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(uint32_t i) {
+    ensureCapacity(_length + NumberBufferSize);
+    _length += formatInteger(uint64_t(i),
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(int64_t l) {
+    ensureCapacity(_length + NumberBufferSize);
+    _length += formatInteger(l,
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(uint64_t l) {
+    ensureCapacity(_length + NumberBufferSize);
+    _length += formatInteger(l,
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(float f) {
+    ensureCapacity(_length + NumberBufferSize);
+    _length += formatFloat(f,
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+Utf8Buffer& Utf8Buffer::operator<<(double d) {
+    ensureCapacity(_length + NumberBufferSize);
+    _length += formatFloat(d,
+            reinterpret_cast<char*>(buf.carray() + _length));
+    return *this;
+}
+
+void Utf8Buffer::writeTo(OutputStream& out) const {
+    // a length of 0 would make write() write the whole buffer
+    if (_length != 0) out.write(buf, 0, _length);
+}
+
+Array<byte> Utf8Buffer::toArray() const {
+    Array<byte> toReturn(_length);
+    carraycopy(buf.carray(), 0, toReturn.carray(), 0, _length);
+    return toReturn;
+}
+
+String Utf8Buffer::toString() const {
+    String toReturn;
+    toReturn.fromUtf8(data(), _length);
+    return toReturn;
+}
+
+void Utf8Buffer::ensureCapacity(size_t capacity) {
+    if (buf.length >= capacity) return;
+
+    // a Utf8Buffer that was moved from has no buffer left to double
+    size_t newsize = buf.length ? buf.length : 64;
+    while (newsize < capacity) newsize = newsize << 1;
+    Array<byte> newbuf(newsize);
+    carraycopy(buf.carray(), 0, newbuf.carray(), 0, _length);
+    buf = std::move(newbuf);
+}
+
+OutputStream& operator<<(OutputStream& out, const Utf8Buffer& buf) {
+    buf.writeTo(out);
+    return out;
+}
+
+SYLPH_END_NAMESPACE
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -0,0 +1,186 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#ifndef SYLPH_CORE_UTF8BUFFER_H_
+#define SYLPH_CORE_UTF8BUFFER_H_
+
+#include "Object.h"
+#include "Array.h"
+#include "Primitives.h"
+#include "String.h"
+#include "../IO/OutputStream.h"
+
+SYLPH_BEGIN_NAMESPACE
+
+/**
+ * A StringBuffer that builds UTF-8 instead of UTF-16. Code that only builds
+ * text to write it out to a file or a socket has no use for UTF-16: with a
+ * Utf8Buffer, Strings are encoded as they are appended, numbers are
+ * formatted straight into the buffer, and the result can be written to an
+ * OutputStream as it is.<p>
+ * All lengths are in bytes. Appended C strings are taken to be UTF-8
+ * already, and are copied as they are. A single <code>char</code> can't hold
+ * more than one byte of UTF-8, so like in StringBuffer it is the character
+ * U+0000 to U+00FF with the same, unsigned, value, and it is encoded.<p>
+ * An example:
+ * <pre>Utf8Buffer out;
+ * out << "user " << name << " logged in after " << ms << "ms\n";
+ * out.writeTo(log);</pre>
+ */
+class Utf8Buffer : public virtual Object {
+public:
+    /**
+     * Creates an empty Utf8Buffer.
+     * @param len The initial capacity, in bytes.
+     */
+    explicit Utf8Buffer(size_t len = 64) : buf(len), _length(0) {}
+    /**
+     * Creates a Utf8Buffer with a copy of the contents of another one.
+     */
+    Utf8Buffer(const Utf8Buffer& other);
+    /**
+     * Creates a Utf8Buffer taking over the contents of another one, which is
+     * left empty.
+     */
+    Utf8Buffer(Utf8Buffer&& other);
+    /** */
+    virtual ~Utf8Buffer();
+
+    /**
+     * Replaces the contents of this Utf8Buffer by a copy of those of another
+     * one.
+     */
+    Utf8Buffer& operator=(const Utf8Buffer& other);
+    /**
+     * Takes over the contents of another Utf8Buffer, which is left empty.
+     */
+    Utf8Buffer& operator=(Utf8Buffer&& other);
+
+    /**
+     * Returns the amount of bytes in this Utf8Buffer.
+     */
+    size_t length() const {
+        return _length;
+    }
+    /**
+     * Returns the amount of bytes this Utf8Buffer can hold before it has to
+     * grow.
+     */
+    size_t capacity() const {
+        return buf.length;
+    }
+    /**
+     * Makes sure this Utf8Buffer can hold at least the given amount of bytes
+     * without growing again.
+     * @param capacity The amount of bytes to make room for.
+     */
+    void reserve(size_t capacity);
+    /**
+     * Empties this Utf8Buffer. Its capacity stays the same.
+     */
+    void clear() {
+        _length = 0;
+    }
+    /**
+     * Returns the bytes in this Utf8Buffer. They are not NUL terminated, and
+     * only valid until the next change to this Utf8Buffer.
+     */
+    const char* data() const {
+        return reinterpret_cast<const char*>(buf.carray());
+    }
+
+    /**
+     * Appends a number of bytes at once. They are expected to be UTF-8.
+     * @param bytes The bytes to append.
+     * @param len The amount of bytes to append.
+     */
+    Utf8Buffer& append(const char* bytes, size_t len);
+    /**
+     * Appends a number of UTF-16 units at once, encoding them to UTF-8.
+     * @param units The units to append.
+     * @param len The amount of units to append.
+     */
+    Utf8Buffer& append(const uchar* units, size_t len);
+
+    /** */
+    Utf8Buffer& operator<<(bool b);
+    /** */
+    Utf8Buffer& operator<<(char c);
+    /** */
+    Utf8Buffer& operator<<(const char* s);
+    /** */
+    Utf8Buffer& operator<<(const String& s);
+    /** */
+    Utf8Buffer& operator<<(int32_t i);
+    /** */
+    Utf8Buffer& operator<<(uint32_t i);
+    /** */
+    Utf8Buffer& operator<<(int64_t l);
+    /** */
+    Utf8Buffer& operator<<(uint64_t l);
+    /** */
+    Utf8Buffer& operator<<(float f);
+    /** */
+    Utf8Buffer& operator<<(double d);
+
+    /** */
+    template<class T>
+    inline Utf8Buffer& operator+=(T t) {
+        return operator<<(t);
+    }
+
+    /**
+     * Writes the contents of this Utf8Buffer to an OutputStream.
+     * @param out The OutputStream to write to.
+     */
+    void writeTo(OutputStream& out) const;
+    /**
+     * Returns a copy of the bytes in this Utf8Buffer.
+     */
+    Array<byte> toArray() const;
+    /**
+     * Decodes the contents of this Utf8Buffer into a String.
+     */
+    String toString() const;
+
+private:
+    friend class Format;
+
+    Array<byte> buf;
+    size_t _length;
+    void ensureCapacity(size_t capacity);
+};
+
+/**
+ * Writes the contents of a Utf8Buffer to an OutputStream.
+ * @see Utf8Buffer::writeTo()
+ */
+OutputStream& operator<<(OutputStream& out, const Utf8Buffer& buf);
+
+SYLPH_END_NAMESPACE
+
+#endif /* SYLPH_CORE_UTF8BUFFER_H_ */
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk
@@ -31,19 +31,51 @@
 #include "Exception.h"
 #include "Array.h"
 
+#include <cstring>
 #include <math.h>
+#include <type_traits>
 
 SYLPH_BEGIN_NAMESPACE
 
+// Copies length elements from src to dest, which may overlap. Types that can
+// be copied as bytes are moved with memmove, which the compiler and the C
+// library turn into vector instructions.
+template<class T>
+inline void copyElements(const T * src, T * dest, size_t length,
+        std::true_type) {
+    // memmove wants valid pointers even for a length of 0
+    if (length != 0) std::memmove(dest, src, length * sizeof(T));
+}
+
+template<class T>
+inline void copyElements(const T * src, T * dest, size_t length,
+        std::false_type) {
+    if (dest <= src || dest >= src + length) {
+        for (size_t i = 0; i < length; i++) dest[i] = src[i];
+    } else {
+        // dest overlaps the end of src, copy back to front
+        for (size_t i = length; i > 0; i--) dest[i - 1] = src[i - 1];
+    }
+}
+
 // TODO: move this to Array
+/**
+ * Copies @em length elements from one C array to another. The ranges may
+ * overlap, the result is as if the source was copied to a temporary first.
+ * No bounds are checked.
+ */
 template<class T>
 inline void carraycopy(const T src[], size_t srcPos, T dest[],
         size_t destPos, size_t length) throw (Exception) {
-    for (size_t i = 0; i < length; i++) {
-        dest[destPos + i] = src[srcPos + i];
-    }
+    copyElements(src + srcPos, dest + destPos, length,
+            std::is_trivially_copyable<T>());
 }
 
+/**
+ * Copies @em length elements from one Array to another, which may be the
+ * same Array.
+ * @throw ArrayException If either range is not within its Array.
+ */
 template<class T>
 inline void arraycopy(const Array<T> & src, size_t srcPos, Array<T> & dest,
         size_t destPos, size_t length) throw (Exception) {
@@ -53,9 +85,7 @@ inline void arraycopy(const Array<T> & src, size_t srcPos, Array<T> & dest,
     if (srcPos + length > srcSize) sthrow(ArrayException, "Source array too short");
     if (destPos + length > destSize) sthrow(ArrayException, "Dest array too short");
 
-    for (size_t i = 0; i < length; i++) {
-        dest[destPos + i] = src[srcPos + i];
-    }
+    carraycopy(src.carray(), srcPos, dest.carray(), destPos, length);
 }
 
 template <typename T, size_t N>
@@ -35,6 +35,7 @@
 
 #include "Debug.h"
 
+#include <utility>
 #include <vector>
 #include <initializer_list>
 
@@ -126,13 +127,25 @@ public:
      *
      * All elements of the other vector will be copied into this vector.
      *
-     * TODO implement this!
+     * @param other The other Vector.
+     * @complexity O(n)
+     */
+    Vector(const Vector<T>& other) : elements(other.elements.length),
+            _size(other._size) {
+        arraycopy(other.elements, 0, elements, 0, other._size);
+    }
+
+    /**
+     * Creates a Vector taking over the elements of another Vector. Nothing
+     * is copied or allocated. The other vector is left empty, with a
+     * capacity of 0.
      *
      * @param other The other Vector.
+     * @complexity O(1)
      */
-    Vector(const Vector<T>& other) {
-        (void)other;
-        SYLPH_STUB;
+    Vector(Vector<T>&& other) : elements(std::move(other.elements)),
+            _size(other._size) {
+        other._size = 0;
     }
 
     /**
@@ -187,13 +200,15 @@ public:
     }
 
     /**
-     * Removes all elements from this vector. This will clear the underlying
-     * array of the vector and reduces the sice effectively to 0.
+     * Removes all elements from this vector. This will reset the elements to
+     * their default value and reduces the size effectively to 0. The capacity
+     * is kept, so that the Vector can be filled again without allocating.
      * @complexity O(n)
      */
     void clear() {
+        T * data = elements.carray();
+        for (idx_t i = 0; i < _size; ++i) data[i] = T();
         _size = 0;
-        elements.clear();
     }
 
     /**
@@ -218,7 +233,7 @@ public:
     const T & get(size_t idx) const throw(ArrayException) {
         try {
             checkIfOutOfBounds(idx);
-            return elements[idx];
+            return elements.unsafeAt(idx);
         }
         straced;
     }
@@ -229,7 +244,7 @@ public:
     T & get(size_t idx) throw(ArrayException) {
         try {
             checkIfOutOfBounds(idx);
-            return elements[idx];
+            return elements.unsafeAt(idx);
         }
         straced;
     }
@@ -300,7 +315,7 @@ public:
     void set(size_t idx, const T & t) throw(ArrayException) {
         try {
             checkIfOutOfBounds(idx);
-            elements[idx] = t;
+            elements.unsafeAt(idx) = t;
         }
         straced;
     }
@@ -317,9 +332,7 @@ public:
      */
     Array<T> toArray() const {
         Array<T> toReturn(size());
-        for(idx_t i = 0; i < size(); ++i) {
-            toReturn[i] = elements[i];
-        }
+        carraycopy(elements.carray(), 0, toReturn.carray(), 0, _size);
         return toReturn;
     }
 
@@ -358,12 +371,25 @@ public:
      * @complexity O(n)
      */
     Vector& operator=(const Vector<T> & rhs) {
+        if (this == &rhs) return *this;
         elements = Array<T > (rhs.elements.length);
         _size = rhs.size();
         arraycopy(rhs.elements, 0, elements, 0, rhs.elements.length);
         return *this;
     }
 
+    /**
+     * Takes over the elements of the other Vector, which is left empty.
+     * @complexity O(1)
+     */
+    Vector& operator=(Vector<T> && rhs) {
+        if (this == &rhs) return *this;
+        elements = std::move(rhs.elements);
+        _size = rhs._size;
+        rhs._size = 0;
+        return *this;
+    }
+
 private:
     Array<T> elements;
     size_t _size;
@@ -372,6 +398,8 @@ private:
         if (capacity > elements.length) {
             size_t newsize;
             newsize = elements.length << 1;
+            // an empty Vector, e.g. one that was moved from, can't double
+            if (newsize < capacity) newsize = capacity;
             Array<T> oldElements = elements;
             elements = Array<T > (newsize);
             arraycopy(oldElements, 0, elements, 0, oldElements.length);
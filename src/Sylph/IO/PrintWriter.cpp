@@ -118,9 +118,10 @@ PrintWriter& PrintWriter::operator<<(float f) {
     return operator<<(String(f));
 }
 
-PrintWriter& PrintWriter::operator<<(String s) {
+PrintWriter& PrintWriter::operator<<(const String& s) {
     const char * toWrite = s.utf8();
-    for (idx_t i = 0; i <= std::strlen(toWrite); i++) {
+    size_t len = std::strlen(toWrite);
+    for (idx_t i = 0; i < len; i++) {
         out << toWrite[i];
     }
     return *this;
@@ -62,7 +62,7 @@ public:
     PrintWriter& operator<<(int64_t l);
     PrintWriter& operator<<(uint64_t l);
     PrintWriter& operator<<(float f);
-    PrintWriter& operator<<(String s);
+    PrintWriter& operator<<(const String& s);
     PrintWriter& operator<<(PrintWriter&(*f)(PrintWriter&));
 private:
     OutputStream& out;
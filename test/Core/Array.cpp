@@ -26,6 +26,15 @@
 #include "../SylphTest.h"
 #include <Sylph/Core/Array.h>
 #include <Sylph/Core/Debug.h>
+#include <Sylph/Core/String.h>
+#include <Sylph/Core/Util.h>
+
+#include <utility>
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+#include <thread>
+#include <vector>
+#endif
 
 using namespace Sylph;
 
@@ -105,19 +114,23 @@ namespace {
         EXPECT_EQ(7, arfilled1[4]);
     }
 
+#if SYLPH_CHECKED_ARRAYS
     TEST_F(TestArray, testOverflow) {
         ASSERT_THROW((*testObj1)[7] = 1, ArrayException);
     }
+#endif
 
     TEST_F(TestArray, testLength) {
         Array<bool> lengthtest((size_t) 6);
         ASSERT_EQ(6u, lengthtest.length);
     }
 
+#if SYLPH_CHECKED_ARRAYS
     TEST_F(TestArray, testLengthOverflow) {
         Array<bool> lengthtest((size_t) 6);
         ASSERT_THROW(lengthtest[6] = false, ArrayException);
     }
+#endif
 
     TEST_F(TestArray, testSelfEquality) {
         ASSERT_EQ(*ar1, *ar1);
@@ -171,9 +184,27 @@ namespace {
         EXPECT_EQ(arfilled1[0], arfilled1[-arfilled1.length]);
     }
 
+#if SYLPH_CHECKED_ARRAYS
     TEST_F(TestArray, testNegativeOverflow) {
         ASSERT_THROW(arfilled1[-(arfilled1.length + 1)] = 3, ArrayException);
     }
+#endif
+
+    TEST_F(TestArray, testUncheckedAccess) {
+        EXPECT_EQ(5, arfilled1.unsafeAt(0));
+        EXPECT_EQ(7, arfilled1.unsafeAt(4));
+        arfilled1.unsafeAt(2) = 3;
+        EXPECT_EQ(3, arfilled1[2]);
+        const Array<int>& constant = arfilled1;
+        EXPECT_EQ(3, constant.unsafeAt(2));
+
+        int sum = 0;
+        const int * end = constant.carrayEnd();
+        for (const int * p = constant.carray(); p != end; ++p) sum += *p;
+        EXPECT_EQ(5 + 2 + 3 + 1 + 7, sum);
+        Array<int> empty;
+        EXPECT_EQ(empty.carray(), empty.carrayEnd());
+    }
 
     TEST_F(TestArray, testRange) {
         Array<int> section = arfilled2[range(2, 4)];
@@ -212,11 +243,83 @@ namespace {
         ASSERT_THROW(arfilled1[range(-2,-7)], ArrayException);
     }
 
+    TEST_F(TestArray, testArraycopyOverlap) {
+        // forwards, as Vector::removeAt does it
+        arraycopy(arfilled2, 1, arfilled2, 0, 5);
+        EXPECT_EQ(Array<int>({0, 2, 3, 4, 6, 6}), arfilled2);
+        // backwards, the destination overlaps the end of the source
+        arraycopy(arfilled3, 0, arfilled3, 2, 4);
+        EXPECT_EQ(Array<int>({8, 0, 8, 0, 2, 3}), arfilled3);
+        arraycopy(arfilled1, 0, *ar1, 0, 0);
+        ASSERT_THROW(arraycopy(arfilled1, 2, *ar1, 0, 4), ArrayException);
+
+        // not trivially copyable, copied element by element
+        Array<String> strings = {"a", "b", "c", "d"};
+        arraycopy(strings, 0, strings, 1, 3);
+        EXPECT_EQ(Array<String>({"a", "a", "b", "c"}), strings);
+        arraycopy(strings, 2, strings, 0, 2);
+        EXPECT_EQ(Array<String>({"b", "c", "b", "c"}), strings);
+    }
+
     TEST_F(TestArray, testRefcounted) {
         Array<int> tmp = arfilled1;
         ASSERT_EQ(arfilled1.carray(), tmp.carray());
     }
 
+    TEST_F(TestArray, testMove) {
+        Array<int> source = arfilled1.copy();
+        const int * data = source.carray();
+        Array<int> moved(std::move(source));
+        EXPECT_EQ(data, moved.carray());
+        EXPECT_EQ(arfilled1, moved);
+        EXPECT_EQ(0u, source.length);
+#if SYLPH_CHECKED_ARRAYS
+        EXPECT_THROW(source[0], ArrayException);
+#endif
+
+        Array<int> assigned((size_t)2);
+        assigned = std::move(moved);
+        EXPECT_EQ(data, assigned.carray());
+        EXPECT_EQ(0u, moved.length);
+
+        // Arrays that were moved from can be copied and cleared.
+        Array<int> copied(moved);
+        EXPECT_EQ(0u, copied.length);
+        EXPECT_EQ(0u, moved.copy().length);
+        moved.clear();
+        copied = source;
+        EXPECT_EQ(copied.carray(), copied.carrayEnd());
+
+        // Arrays that were moved from can be reused.
+        moved = arfilled1;
+        EXPECT_EQ(arfilled1, moved);
+        source = Array<int>((size_t)3);
+        EXPECT_EQ(3u, source.length);
+    }
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    void copyArrayLoop(const Array<int>* shared) {
+        for (int i = 0; i < 100000; ++i) {
+            Array<int> a = *shared;
+            Array<int> b(a);
+            b = a;
+        }
+    }
+
+    TEST_F(TestArray, testThreadedRefcount) {
+        Array<int> shared = arfilled1;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.push_back(std::thread(copyArrayLoop, &shared));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        EXPECT_EQ(arfilled1.carray(), shared.carray());
+        EXPECT_EQ(arfilled1, shared);
+    }
+#endif
+
 } // namespace
 
 // vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src
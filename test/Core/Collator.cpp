@@ -0,0 +1,126 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "../SylphTest.h"
+#include <Sylph/Core/Collator.h>
+#include <Sylph/Core/String.h>
+#include <Sylph/Core/Debug.h>
+
+#include <cstdlib>
+
+using namespace Sylph;
+
+namespace {
+
+    class TestCollator : public ::testing::Test {
+    };
+
+    TEST_F(TestCollator, testCompare) {
+        Collator collator("en");
+        EXPECT_GT(0, collator.compare("eclair", "\xC3\xA9" "clair"));
+        EXPECT_GT(0, collator.compare("\xC3\xA9" "clair", "fclair"));
+        EXPECT_GT(0, collator.compare("a", "B"));
+        EXPECT_LT(0, collator.compare("b", "A"));
+        EXPECT_EQ(0, collator.compare("same", "same"));
+        // Canonically equivalent Strings are equal for the Collator.
+        EXPECT_EQ(0, collator.compare("\xC3\xA9", "e\xCC\x81"));
+    }
+
+    TEST_F(TestCollator, testStrength) {
+        Collator primary("en", Collator::Primary);
+        EXPECT_EQ(0, primary.compare("abc", "ABC"));
+        EXPECT_EQ(0, primary.compare("abc", "\xC3\xA1" "bc"));
+        Collator secondary("en", Collator::Secondary);
+        EXPECT_EQ(0, secondary.compare("abc", "ABC"));
+        EXPECT_NE(0, secondary.compare("abc", "\xC3\xA1" "bc"));
+        Collator tertiary("en", Collator::Tertiary);
+        EXPECT_NE(0, tertiary.compare("abc", "ABC"));
+    }
+
+    TEST_F(TestCollator, testKey) {
+        Collator collator("en");
+        CollationKey a = collator.key("apple");
+        CollationKey b = collator.key("Banana");
+        EXPECT_EQ(String("apple"), a.source());
+        EXPECT_TRUE(a < b);
+        EXPECT_FALSE(b < a);
+        EXPECT_TRUE(a == collator.key("apple"));
+        EXPECT_TRUE(a != b);
+        EXPECT_TRUE(CollationKey() < a);
+        EXPECT_EQ(0, CollationKey().compareTo(CollationKey()));
+
+        // Long Strings get keys that do not fit on the stack.
+        String longer = String("abcdefghij") * 100;
+        EXPECT_TRUE(collator.key(longer) < collator.key(longer + "a"));
+    }
+
+    TEST_F(TestCollator, testKeyMatchesCompare) {
+        Collator collator("de");
+        const char * words[] = { "Apfel", "apfel", "\xC3\x84pfel", "Bauer",
+                "b\xC3\xA4uerin", "Zebra", "zoo", "\xC3\x96l", "Ol", "", "a",
+                "stra\xC3\x9F" "e", "strasse", "Strasse" };
+        const size_t count = sizeof(words) / sizeof(words[0]);
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < count; ++j) {
+                int expected = collator.compare(words[i], words[j]);
+                int actual = collator.key(words[i]).compareTo(
+                        collator.key(words[j]));
+                EXPECT_EQ(expected < 0, actual < 0) << words[i] << words[j];
+                EXPECT_EQ(expected == 0, actual == 0) << words[i] << words[j];
+            }
+        }
+    }
+
+    TEST_F(TestCollator, testSort) {
+        Collator collator("en");
+        Array<String> names = { "zoe", "\xC3\x89mile", "adam", "Eve", "eve",
+                "Bob", "emile" };
+        collator.sort(names);
+        for (idx_t i = 1; i < names.length; ++i) {
+            EXPECT_GE(0, collator.compare(names[i - 1], names[i]))
+                    << names[i - 1] << " " << names[i];
+        }
+        EXPECT_EQ(String("adam"), names[0]);
+        EXPECT_EQ(String("zoe"), names[names.length - 1]);
+
+        srand(7);
+        Array<String> many((uint32_t)500);
+        for (idx_t i = 0; i < many.length; ++i) {
+            char buf[9];
+            for (int j = 0; j < 8; ++j) {
+                buf[j] = (rand() % 2 ? 'a' : 'A') + rand() % 26;
+            }
+            buf[8] = '\0';
+            many[i] = buf;
+        }
+        collator.sort(many);
+        for (idx_t i = 1; i < many.length; ++i) {
+            EXPECT_GE(0, collator.compare(many[i - 1], many[i]));
+        }
+    }
+
+} // namespace
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src
@@ -52,6 +52,18 @@ namespace {
         f /= "example";
         EXPECT_EQ("/var/foo/example",f);
     }
+
+    TEST_F(TestFile, testIterate) {
+        File f = "/var/foo/example";
+        File::iterator it = f.begin();
+        EXPECT_EQ("var", *it);
+        ++it;
+        EXPECT_EQ("foo", *it);
+        ++it;
+        EXPECT_EQ("example", *it);
+        String s = *it;
+        EXPECT_EQ(7u, s.length());
+    }
 }
 
 // vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src
@@ -0,0 +1,161 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "../SylphTest.h"
+#include <Sylph/Core/Format.h>
+#include <Sylph/Core/ByteBuffer.h>
+#include <Sylph/Core/String.h>
+#include <Sylph/Core/StringBuffer.h>
+#include <Sylph/Core/StringView.h>
+#include <Sylph/Core/Utf8Buffer.h>
+#include <Sylph/Core/Debug.h>
+
+#include <cstring>
+
+using namespace Sylph;
+
+namespace {
+
+    class TestFormat : public ::testing::Test {
+    };
+
+    TEST_F(TestFormat, testPlain) {
+        EXPECT_EQ(String(""), format(""));
+        EXPECT_EQ(String("no fields"), format("no fields"));
+        EXPECT_EQ(String("{braces}"), format("{{braces}}"));
+        EXPECT_EQ(String("1 + 2 = 3"), format("{} + {} = {}", 1, 2, 3));
+        EXPECT_EQ(String("b a b"), format("{1} {0} {1}", 'a', 'b'));
+        EXPECT_EQ(String("true false"), format("{} {}", true, false));
+        EXPECT_EQ(String("caf\xC3\xA9: 1"), format("caf\xC3\xA9: {}", 1));
+    }
+
+    TEST_F(TestFormat, testIntegers) {
+        EXPECT_EQ(String("-42"), format("{}", -42));
+        EXPECT_EQ(String("18446744073709551615"),
+                format("{}", uint64_t(-1)));
+        EXPECT_EQ(String("-9223372036854775808"),
+                format("{}", int64_t(1) << 63));
+        EXPECT_EQ(String("00c0ffee"), format("{:08x}", 0xc0ffee));
+        EXPECT_EQ(String("0XC0FFEE"), format("{:#X}", 0xc0ffee));
+        EXPECT_EQ(String("0b101 17 017"),
+                format("{0:#b} {1:o} {1:#o}", 5, 15));
+        EXPECT_EQ(String("-0042"), format("{:05}", -42));
+        EXPECT_EQ(String("+42 / 42"), format("{:+} /{: }", 42, 42));
+        EXPECT_EQ(String("   42|42   | 42 "),
+                format("{0:>5}|{0:<5}|{0:^4}", 42));
+        EXPECT_EQ(String("**42"), format("{:*>4}", 42));
+        EXPECT_EQ(String("A \xE2\x82\xAC"), format("{:c} {:c}", 65, 0x20AC));
+        EXPECT_EQ(String("1 98"), format("{:d} {:d}", true, 'b'));
+        EXPECT_EQ(String("3.000000"), format("{:f}", 3));
+    }
+
+    TEST_F(TestFormat, testFloats) {
+        EXPECT_EQ(String("0.1 0.25"), format("{} {}", 0.1, 0.25f));
+        EXPECT_EQ(String("3.14"), format("{:.2f}", 3.14159));
+        EXPECT_EQ(String("3.142"), format("{:.4}", 3.14159));
+        EXPECT_EQ(String("1.500000e+00"), format("{:e}", 1.5));
+        EXPECT_EQ(String("-001.50"), format("{:07.2f}", -1.5));
+        EXPECT_EQ(String("  +1.5"), format("{:+6}", 1.5));
+        EXPECT_EQ(String("NaN -Infinity"),
+                format("{} {:.2f}", 0.0 / 0.0, -1.0 / 0.0));
+    }
+
+    TEST_F(TestFormat, testStrings) {
+        String s = "h\xC3\xA9llo";
+        EXPECT_EQ(String("h\xC3\xA9llo|h\xC3\xA9llo"), format("{}|{:s}", s,
+                "h\xC3\xA9llo"));
+        EXPECT_EQ(String("h\xC3\xA9llo   |   h\xC3\xA9llo|.h\xC3\xA9llo."),
+                format("{0:8}|{0:>8}|{0:.^7}", s));
+        EXPECT_EQ(String("h\xC3\xA9l|h\xC3\xA9l"),
+                format("{:.3}|{:.3}", s, "h\xC3\xA9llo"));
+        EXPECT_EQ(String("ll"), format("{}", s.slice(2, 3)));
+        EXPECT_EQ(String("literal"), format("{}", u"literal"_s));
+        // surrogate pairs are never split
+        EXPECT_EQ(String("a"), format("{:.2}", "a\xF0\x9F\x98\x80"));
+        EXPECT_EQ(String("a|"), format("{:.2}|", String("a\xF0\x9F\x98\x80")));
+        EXPECT_EQ(String("a  |"), format("{:3}|", "a"));
+        EXPECT_EQ(String("\xC3\xA9|233"), format("{}|{:d}", char(0xE9),
+                char(0xE9)));
+        Utf8Buffer utf8;
+        format(utf8, "{:c}", char(0xE9));
+        EXPECT_EQ(String("\xC3\xA9"), utf8.toString());
+    }
+
+    TEST_F(TestFormat, testBuffers) {
+        StringBuffer buf;
+        buf << "crc ";
+        format(buf, "{}: {:08x}", String("file"), 0xbeef);
+        EXPECT_EQ(String("crc file: 0000beef"), buf.toString());
+
+        Utf8Buffer utf8;
+        format(utf8, "{} \xE2\x82\xAC{:.2f}", String("caf\xC3\xA9"), 2.5);
+        const char expected[] = "caf\xC3\xA9 \xE2\x82\xAC" "2.50";
+        ASSERT_EQ(sizeof(expected) - 1, utf8.length());
+        EXPECT_EQ(0, std::memcmp(expected, utf8.data(), utf8.length()));
+
+        ByteBuffer out;
+        format(out, "{}-{}", 1, 2);
+        EXPECT_EQ(3u, out.size());
+        Format("{:>3}").format(out, 7);
+        EXPECT_EQ(6u, out.size());
+    }
+
+    TEST_F(TestFormat, testPreparsed) {
+        Format line("{:<6}|{:>4}");
+        Format copy = line;
+        StringBuffer buf;
+        for (int i = 0; i < 3; ++i) {
+            copy.format(buf, "row", i);
+            buf << '\n';
+        }
+        EXPECT_EQ(String("row   |   0\nrow   |   1\nrow   |   2\n"),
+                buf.toString());
+        EXPECT_EQ(String("a     |   b"), line.toString("a", "b"));
+
+        Utf8Buffer utf8;
+        line.format(utf8, 1, 2);
+        EXPECT_EQ(String("1     |   2"), utf8.toString());
+    }
+
+    TEST_F(TestFormat, testErrors) {
+        EXPECT_THROW(Format("{"), IllegalArgumentException);
+        EXPECT_THROW(Format("}"), IllegalArgumentException);
+        EXPECT_THROW(Format("{:q}"), IllegalArgumentException);
+        EXPECT_THROW(Format("{:.}"), IllegalArgumentException);
+        EXPECT_THROW(Format("{:99999999999}"), IllegalArgumentException);
+        EXPECT_THROW(format("{} {}", 1), IllegalArgumentException);
+        EXPECT_THROW(format("{1}", 1), IllegalArgumentException);
+        EXPECT_THROW(format("{:x}", "text"), IllegalArgumentException);
+        EXPECT_THROW(format("{:d}", 1.5), IllegalArgumentException);
+        EXPECT_THROW(format("{:s}", 1), IllegalArgumentException);
+        EXPECT_THROW(format("{:.2}", 1), IllegalArgumentException);
+        EXPECT_THROW(format("{:c}", -1), IllegalArgumentException);
+        EXPECT_THROW(format("{:.200f}", 1.5), IllegalArgumentException);
+        EXPECT_NO_THROW(Format("{:}"));
+    }
+
+} // namespace
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src
@@ -0,0 +1,243 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+
+#include "../SylphTest.h"
+#include <Sylph/Core/Regex.h>
+#include <Sylph/Core/String.h>
+#include <Sylph/Core/StringView.h>
+#include <Sylph/Core/Debug.h>
+
+using namespace Sylph;
+
+namespace {
+
+    class TestRegex : public ::testing::Test {
+    };
+
+    TEST_F(TestRegex, testMatches) {
+        EXPECT_TRUE(Regex("abc").matches(String("abc")));
+        EXPECT_FALSE(Regex("abc").matches(String("abcd")));
+        EXPECT_FALSE(Regex("abc").matches(String("xabc")));
+        EXPECT_TRUE(Regex("a.c").matches(String("a-c")));
+        EXPECT_FALSE(Regex("a.c").matches(String("a\nc")));
+        EXPECT_TRUE(Regex("ab*c").matches(String("ac")));
+        EXPECT_TRUE(Regex("ab*c").matches(String("abbbc")));
+        EXPECT_FALSE(Regex("ab+c").matches(String("ac")));
+        EXPECT_TRUE(Regex("ab?c").matches(String("abc")));
+        EXPECT_TRUE(Regex("a{2,3}").matches(String("aaa")));
+        EXPECT_FALSE(Regex("a{2,3}").matches(String("aaaa")));
+        EXPECT_FALSE(Regex("a{2,}").matches(String("a")));
+        EXPECT_TRUE(Regex("a{2,}").matches(String("aaaaaa")));
+        EXPECT_TRUE(Regex("a{2}").matches(String("aa")));
+        EXPECT_TRUE(Regex("a{,2}").matches(String("a{,2}")));
+        EXPECT_TRUE(Regex("cat|dog").matches(String("dog")));
+        EXPECT_TRUE(Regex("(?:ab)+").matches(String("ababab")));
+        EXPECT_FALSE(Regex("(?:ab)+").matches(String("ababa")));
+        EXPECT_TRUE(Regex("").matches(String("")));
+        EXPECT_FALSE(Regex("").matches(String("a")));
+        EXPECT_TRUE(Regex("a\\.b\\*").matches(String("a.b*")));
+    }
+
+    TEST_F(TestRegex, testClasses) {
+        EXPECT_TRUE(Regex("\\d+").matches(String("0123456789")));
+        EXPECT_FALSE(Regex("\\d").matches(String("a")));
+        EXPECT_TRUE(Regex("\\D\\W\\S").matches(String("a-x")));
+        EXPECT_TRUE(Regex("\\w+\\s\\w+").matches(
+                String("snake_case\tWord42")));
+        EXPECT_TRUE(Regex("[a-f0-9]+").matches(String("deadbeef00")));
+        EXPECT_FALSE(Regex("[a-f0-9]+").matches(String("deadbeefg")));
+        EXPECT_TRUE(Regex("[^abc]").matches(String("d")));
+        EXPECT_FALSE(Regex("[^abc]").matches(String("b")));
+        EXPECT_TRUE(Regex("[]a]+").matches(String("]a]")));
+        EXPECT_TRUE(Regex("[a-]+").matches(String("-a-")));
+        EXPECT_TRUE(Regex("[\\d.]+").matches(String("1.5")));
+        EXPECT_TRUE(Regex("\\x41\\u00e9").matches(String("A\xC3\xA9")));
+        EXPECT_TRUE(Regex("[\\u00e0-\\u00ff]").matches(String("\xC3\xA9")));
+        EXPECT_TRUE(Regex("[^a]").matches(String("\xC3\xA9")));
+    }
+
+    TEST_F(TestRegex, testAnchors) {
+        EXPECT_TRUE(Regex("^abc").foundIn(String("abcdef")));
+        EXPECT_FALSE(Regex("^abc").foundIn(String("xabc")));
+        EXPECT_TRUE(Regex("def$").foundIn(String("abcdef")));
+        EXPECT_FALSE(Regex("def$").foundIn(String("defx")));
+        EXPECT_TRUE(Regex("^$").matches(String("")));
+        EXPECT_TRUE(Regex("a|^b").foundIn(String("b")));
+        EXPECT_FALSE(Regex("x^b").foundIn(String("xb")));
+    }
+
+    TEST_F(TestRegex, testFind) {
+        Regex regex("\\d+");
+        Regex::Match m = regex.find(String("abc 123 def 45"));
+        ASSERT_TRUE(m.matched());
+        EXPECT_EQ(4, m.start());
+        EXPECT_EQ(7, m.end());
+        EXPECT_EQ(String("123"), m.group().toString());
+
+        m = regex.find(String("abc 123 def 45"), 7);
+        ASSERT_TRUE(m.matched());
+        EXPECT_EQ(String("45"), m.group().toString());
+
+        EXPECT_FALSE(regex.find(String("no digits")).matched());
+        EXPECT_FALSE(regex.foundIn(String("no digits")));
+        EXPECT_TRUE(regex.foundIn(String("one 1")));
+        EXPECT_THROW(regex.find(String("abc"), 4), ArrayException);
+    }
+
+    TEST_F(TestRegex, testLeftmostFirst) {
+        // Alternatives are tried in order, like in Perl.
+        EXPECT_EQ(String("a"),
+                Regex("a|ab").find(String("ab")).group().toString());
+        EXPECT_EQ(String("ab"),
+                Regex("ab|a").find(String("ab")).group().toString());
+        // Greedy and lazy quantifiers.
+        EXPECT_EQ(String("<a><b>"),
+                Regex("<.*>").find(String("<a><b>")).group().toString());
+        EXPECT_EQ(String("<a>"),
+                Regex("<.*?>").find(String("<a><b>")).group().toString());
+        EXPECT_EQ(String("aa"),
+                Regex("a{1,2}").find(String("aaa")).group().toString());
+        EXPECT_EQ(String("a"),
+                Regex("a{1,2}?").find(String("aaa")).group().toString());
+        // The leftmost match wins, even if a later one is longer.
+        EXPECT_EQ(1, Regex("b+|c+").find(String("abccc")).start());
+    }
+
+    TEST_F(TestRegex, testGroups) {
+        Regex regex("(\\w+)=(\\d+)(?:;(x))?");
+        EXPECT_EQ(3u, regex.groupCount());
+
+        Regex::Match m = regex.match(String("key=42"));
+        ASSERT_TRUE(m.matched());
+        EXPECT_EQ(3u, m.groupCount());
+        EXPECT_EQ(String("key=42"), m.group(0).toString());
+        EXPECT_EQ(String("key"), m.group(1).toString());
+        EXPECT_EQ(String("42"), m.group(2).toString());
+        EXPECT_EQ(-1, m.start(3));
+        EXPECT_EQ(0u, m.group(3).length());
+        EXPECT_THROW(m.group(4), ArrayException);
+
+        m = regex.match(String("key=42;x"));
+        EXPECT_EQ(String("x"), m.group(3).toString());
+
+        EXPECT_FALSE(regex.match(String("key=")).matched());
+        EXPECT_THROW(regex.match(String("key=")).start(), ArrayException);
+
+        // The last iteration of a repeated group is the one that is kept.
+        m = Regex("(?:(a)|(b))+").match(String("ab"));
+        EXPECT_EQ(0, m.start(1));
+        EXPECT_EQ(String("b"), m.group(2).toString());
+    }
+
+    TEST_F(TestRegex, testFindAll) {
+        Array<Regex::Match> all = Regex("\\d+").findAll(String("1, 22, 333"));
+        ASSERT_EQ(3u, all.length);
+        EXPECT_EQ(String("1"), all[0].group().toString());
+        EXPECT_EQ(String("22"), all[1].group().toString());
+        EXPECT_EQ(String("333"), all[2].group().toString());
+
+        // Empty matches step over one character.
+        EXPECT_EQ(4u, Regex("x*").findAll(String("abc")).length);
+        EXPECT_EQ(0u, Regex("x").findAll(String("abc")).length);
+    }
+
+    TEST_F(TestRegex, testView) {
+        // Matching works on views, and offsets are relative to the view.
+        String line = "[12:00:01] ERROR disk full";
+        StringView msg = StringView(line).slice(11, line.length() - 1);
+        Regex regex("^(\\w+) (.*)$");
+        Regex::Match m = regex.match(msg);
+        ASSERT_TRUE(m.matched());
+        EXPECT_EQ(0, m.start(1));
+        EXPECT_EQ(String("ERROR"), m.group(1).toString());
+        EXPECT_EQ(String("disk full"), m.group(2).toString());
+    }
+
+    TEST_F(TestRegex, testSurrogates) {
+        // U+1F600 is one code point, so it's matched by a single dot.
+        String smiley = "\xF0\x9F\x98\x80";
+        EXPECT_TRUE(Regex("^.$").matches(smiley));
+        EXPECT_TRUE(Regex(smiley + "+").matches(smiley + smiley));
+        Regex::Match m = Regex("b").find(String("a") + smiley + "b");
+        EXPECT_EQ(3, m.start());
+        EXPECT_EQ(2u, Regex(".").findAll(smiley + "a").length);
+    }
+
+    TEST_F(TestRegex, testParseErrors) {
+        EXPECT_THROW(Regex("(abc"), ParseException);
+        EXPECT_THROW(Regex("abc)"), ParseException);
+        EXPECT_THROW(Regex("[abc"), ParseException);
+        EXPECT_THROW(Regex("*a"), ParseException);
+        EXPECT_THROW(Regex("a**"), ParseException);
+        EXPECT_THROW(Regex("^*"), ParseException);
+        EXPECT_THROW(Regex("[z-a]"), ParseException);
+        EXPECT_THROW(Regex("a{3,2}"), ParseException);
+        EXPECT_THROW(Regex("a{1001}"), ParseException);
+        EXPECT_THROW(Regex("\\q"), ParseException);
+        EXPECT_THROW(Regex("\\xZZ"), ParseException);
+        EXPECT_THROW(Regex("abc\\"), ParseException);
+        EXPECT_THROW(Regex("(?=a)"), ParseException);
+        EXPECT_THROW(Regex(String("(a)") * 1001), ParseException);
+        // fewer groups, but too many captures for every thread to keep
+        EXPECT_THROW(Regex(String("(a)") * 900 + String("b") * 2000),
+                ParseException);
+    }
+
+    TEST_F(TestRegex, testManyGroups) {
+        Regex regex(String("(a)") * 1000);
+        String text = String("a") * 1000;
+        Regex::Match m = regex.match(text);
+        ASSERT_TRUE(m.matched());
+        EXPECT_EQ(1000u, m.groupCount());
+        EXPECT_EQ(999, m.start(1000));
+        // the scratch memory of the NFA is reused, also between matches
+        EXPECT_EQ(3u, regex.findAll(text * 3).length);
+        EXPECT_FALSE(regex.match(text + "b").matched());
+    }
+
+    TEST_F(TestRegex, testCopy) {
+        Regex regex("a+");
+        Regex copy = regex;
+        regex = Regex("b+");
+        EXPECT_EQ(String("a+"), copy.pattern());
+        EXPECT_TRUE(copy.matches(String("aaa")));
+        EXPECT_TRUE(regex.matches(String("bbb")));
+    }
+
+    TEST_F(TestRegex, testLinear) {
+        // Backtracking matchers take exponential time on these.
+        String text = String("a") * 5000;
+        EXPECT_FALSE(Regex("(a*)*b").foundIn(text));
+        EXPECT_FALSE(Regex("(a|aa)+$").find(text + "b").matched());
+        EXPECT_TRUE(Regex("(a|aa)+").matches(text));
+        // So many states that the DFA gives up and the NFA takes over.
+        Regex big("[ab]*a[ab]{12}");
+        EXPECT_TRUE(big.matches(String("ab") * 500 + "aaaaaaaaaaaaa"));
+        EXPECT_FALSE(big.matches(String("ab") * 500 + "bbbbbbbbbbbbb"));
+    }
+
+} // namespace
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src
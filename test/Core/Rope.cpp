@@ -0,0 +1,165 @@
+/*
+ * LibSylph Class Library
+ * Copyright (C) 2013 Frank "SeySayux" Erens <seysayux@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ *
+ */
+#include "../SylphTest.h"
+#include <Sylph/Core/Rope.h>
+#include <Sylph/Core/String.h>
+
+#include <sstream>
+#include <string>
+
+using namespace Sylph;
+
+namespace {
+
+    class TestRope : public ::testing::Test {
+    };
+
+    TEST_F(TestRope, testEmpty) {
+        Rope r;
+        EXPECT_TRUE(r.empty());
+        EXPECT_EQ(0u, r.length());
+        EXPECT_EQ("", r.toString());
+        EXPECT_TRUE(Rope(String()).empty());
+#if SYLPH_CHECKED_ARRAYS
+        EXPECT_THROW(r.at(0), ArrayException);
+#endif
+    }
+
+    TEST_F(TestRope, testConcat) {
+        Rope r = "foo";
+        r += "bar";
+        Rope s = r + Rope("baz");
+        EXPECT_EQ("foobar", r.toString());
+        EXPECT_EQ("foobarbaz", s.toString());
+        EXPECT_EQ(9u, s.length());
+        EXPECT_EQ('f', s.at(0));
+        EXPECT_EQ('z', s.at(-1));
+#if SYLPH_CHECKED_ARRAYS
+        EXPECT_THROW(s.at(9), ArrayException);
+#endif
+    }
+
+    TEST_F(TestRope, testLargeConcat) {
+        // Long enough to not merge any leaves, and compared against a
+        // std::string built the same way.
+        String piece = String("x") * (Rope::MergeLength + 1);
+        Rope r;
+        std::string expected;
+        for (int i = 0; i < 1000; ++i) {
+            r += piece + String(i);
+            expected += std::string(Rope::MergeLength + 1, 'x') +
+                    std::to_string(i);
+        }
+        ASSERT_EQ(expected.size(), r.length());
+        EXPECT_EQ(String(expected), r.toString());
+        for (size_t i = 0; i < expected.size(); i += 997) {
+            EXPECT_EQ(uchar(expected[i]), r.at(i));
+        }
+    }
+
+    TEST_F(TestRope, testCharByChar) {
+        Rope r;
+        std::string expected;
+        for (int i = 0; i < 10000; ++i) {
+            char c = char('a' + i % 26);
+            r += String(uchar(c));
+            expected += c;
+        }
+        EXPECT_EQ(String(expected), r.toString());
+    }
+
+    TEST_F(TestRope, testPrepend) {
+        Rope r;
+        std::string expected;
+        for (int i = 0; i < 1000; ++i) {
+            r = Rope(String(i) + ",") + r;
+            expected = std::to_string(i) + "," + expected;
+        }
+        EXPECT_EQ(String(expected), r.toString());
+    }
+
+    TEST_F(TestRope, testSlice) {
+        Rope r = Rope("Hello") + Rope(", ") + Rope("World") + Rope("!");
+        EXPECT_EQ("Hello", r.slice(0, 4).toString());
+        EXPECT_EQ("lo, Wo", r.slice(3, 8).toString());
+        EXPECT_EQ("World!", r.slice(7).toString());
+        EXPECT_EQ("!", r.slice(12, 12).toString());
+        EXPECT_THROW(r.slice(5, 4), ArrayException);
+        EXPECT_THROW(r.slice(0, 13), ArrayException);
+        // the original is unchanged
+        EXPECT_EQ("Hello, World!", r.toString());
+    }
+
+    TEST_F(TestRope, testInsert) {
+        Rope r = "Hello World";
+        Rope s = r.insert(5, ",");
+        EXPECT_EQ("Hello, World", s.toString());
+        EXPECT_EQ("Hello World", r.toString());
+        EXPECT_EQ(">Hello World", r.insert(0, ">").toString());
+        EXPECT_EQ("Hello World<", r.insert(11, "<").toString());
+        EXPECT_THROW(r.insert(12, "<"), ArrayException);
+        EXPECT_EQ("x", Rope().insert(0, "x").toString());
+    }
+
+    TEST_F(TestRope, testEditsMatchString) {
+        // Many random inserts and slices, checked against std::string.
+        Rope r = "seed";
+        std::string expected = "seed";
+        unsigned state = 12345;
+        for (int i = 0; i < 2000; ++i) {
+            state = state * 1103515245u + 12345u;
+            size_t at = (state >> 8) % (expected.size() + 1);
+            std::string piece = std::to_string(i) + (i % 7 == 0 ?
+                    std::string(300, 'y') : std::string());
+            r = r.insert(at, String(piece));
+            expected.insert(at, piece);
+            if (i % 10 == 9) {
+                state = state * 1103515245u + 12345u;
+                size_t b = (state >> 8) % expected.size();
+                size_t e = b + (state >> 4) % (expected.size() - b);
+                r = r.slice(b, e);
+                expected = expected.substr(b, e - b + 1);
+            }
+        }
+        ASSERT_EQ(expected.size(), r.length());
+        EXPECT_EQ(String(expected), r.toString());
+    }
+
+    TEST_F(TestRope, testStream) {
+        std::ostringstream out;
+        out << (Rope("foo") + Rope("bar"));
+        EXPECT_EQ("foobar", out.str());
+    }
+
+    TEST_F(TestRope, testStringMultiply) {
+        EXPECT_EQ("", String("abc") * 0);
+        EXPECT_EQ("", String() * 5);
+        EXPECT_EQ("abcabcabc", String("abc") * 3);
+        EXPECT_EQ(String("ab") * 500, String("abab") * 250);
+    }
+
+} // namespace
+
+// vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src
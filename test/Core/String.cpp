@@ -25,10 +25,33 @@
 
 #include "../SylphTest.h"
 #include <Sylph/Core/String.h>
+#include <Sylph/Core/StringBuffer.h>
+#include <Sylph/Core/StringMatcher.h>
+#include <Sylph/Core/StringPool.h>
+#include <Sylph/Core/StringSearcher.h>
+#include <Sylph/Core/StringTokenizer.h>
+#include <Sylph/Core/StringView.h>
+#include <Sylph/Core/Utf8Buffer.h>
+#include <Sylph/Core/Vector.h>
+#include <Sylph/Core/ByteBuffer.h>
 #include <Sylph/Core/Debug.h>
 
 // for strcmp
 #include <cstring>
+#include <sstream>
+// for strtod and the float limits
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+// for the sort reference
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+#include <thread>
+#endif
 
 using namespace Sylph;
 
@@ -139,6 +162,55 @@ namespace {
         EXPECT_EQ("3.14", t);
     }
 
+    TEST_F(TestString, testIntConstructorExtremes) {
+        EXPECT_EQ("0", String(0));
+        EXPECT_EQ("-1", String(-1));
+        EXPECT_EQ("-2147483648", String(INT32_MIN));
+        EXPECT_EQ("4294967295", String(UINT32_MAX));
+        EXPECT_EQ("-9223372036854775808", String(INT64_MIN));
+        EXPECT_EQ("18446744073709551615", String(UINT64_MAX));
+    }
+
+    TEST_F(TestString, testFloatConstructorShortest) {
+        EXPECT_EQ("0.30000000000000004", String(0.1 + 0.2));
+        EXPECT_EQ("0.1", String(0.1));
+        EXPECT_EQ("0.1", String(0.1f));
+        EXPECT_EQ("100", String(100.0));
+        EXPECT_EQ("-2.5", String(-2.5));
+        EXPECT_EQ("1e+20", String(1e20));
+        EXPECT_EQ("1.234e+16", String(1.234e16));
+        EXPECT_EQ("0.0001", String(0.0001));
+        EXPECT_EQ("1e-05", String(0.00001));
+        EXPECT_EQ("5e-324", String(std::numeric_limits<double>::denorm_min()));
+        EXPECT_EQ("1.7976931348623157e+308",
+                String(std::numeric_limits<double>::max()));
+        EXPECT_EQ("1.6777216e+07", String(16777216.f));
+        EXPECT_EQ("3.4028235e+38", String(std::numeric_limits<float>::max()));
+    }
+
+    TEST_F(TestString, testFloatConstructorRoundTrip) {
+        double d = 1.0;
+        for (int i = 0; i < 1000; ++i) {
+            d *= -1.0123456789;
+            String s = d;
+            EXPECT_EQ(d, std::strtod(s.ascii(), 0)) << s;
+        }
+    }
+
+    TEST_F(TestString, testFloatConstructorSpecial) {
+        EXPECT_EQ("0", String(0.0));
+        EXPECT_EQ("-0", String(-0.0));
+        EXPECT_EQ("Infinity", String(std::numeric_limits<double>::infinity()));
+        EXPECT_EQ("-Infinity",
+                String(-std::numeric_limits<float>::infinity()));
+        EXPECT_EQ("NaN", String(std::numeric_limits<double>::quiet_NaN()));
+    }
+
+    TEST_F(TestString, testFromSci) {
+        EXPECT_EQ("1.500000e+00", String::fromSci(1.5f, false));
+        EXPECT_EQ("1.500000000000000E+00", String::fromSci(1.5, true));
+    }
+
     TEST_F(TestString, testLength) {
         String s = "foobar";
         EXPECT_EQ(6u, s.length());
@@ -183,6 +255,96 @@ namespace {
         EXPECT_EQ(0xFFFD, s.at(0));
     }
 
+    TEST_F(TestString, testLongUtf8RoundTrip) {
+        const char * c = "The quick brown fox jumps over the lazy dog. "
+                "Voix ambiguë d'un cœur qui au zéphyr préfère les jattes de "
+                "kiwis. 色は匂へど散りぬるを, and some trailing ASCII text.";
+        String s = c;
+        EXPECT_EQ(0x00EB, s.at(56));
+        EXPECT_EQ(0x0153, s.at(64));
+        EXPECT_EQ(0x8272, s.at(-41));
+        EXPECT_STREQ(c, s.utf8());
+        EXPECT_EQ(s, String(s.utf8()));
+    }
+
+    TEST_F(TestString, testTruncatedUnicode) {
+        char c[] = { 'a', char(0xC3), 0x00 };
+        String s = c;
+        ASSERT_EQ(2u, s.length());
+        EXPECT_EQ('a', s.at(0));
+        EXPECT_EQ(0xFFFD, s.at(1));
+
+        char d[] = { char(0xE2), char(0x82), 'b', 0x00 };
+        String t = d;
+        ASSERT_EQ(2u, t.length());
+        EXPECT_EQ(0xFFFD, t.at(0));
+        EXPECT_EQ('b', t.at(1));
+    }
+
+    TEST_F(TestString, testLongToAscii) {
+        String s = "abcdefghijklmnopqrstuvwxyzéabcdefghijklmnopqrstuvwxyz";
+        EXPECT_STREQ("abcdefghijklmnopqrstuvwxyz?abcdefghijklmnopqrstuvwxyz",
+                s.ascii());
+        std::string t = "0123456789abcdefghijklmnopqrstuvwxyz";
+        EXPECT_EQ(String("0123456789abcdefghijklmnopqrstuvwxyz"), String(t));
+    }
+
+    TEST_F(TestString, testSurrogatePairs) {
+        // U+1F600 GRINNING FACE, U+10348 GOTHIC LETTER HWAIR
+        String s = "a\xF0\x9F\x98\x80" "b\xF0\x90\x8D\x88";
+        ASSERT_EQ(6u, s.length());
+        EXPECT_EQ('a', s.at(0));
+        EXPECT_EQ(0xD83D, s.at(1));
+        EXPECT_EQ(0xDE00, s.at(2));
+        EXPECT_EQ('b', s.at(3));
+        EXPECT_EQ(0xD800, s.at(4));
+        EXPECT_EQ(0xDF48, s.at(5));
+        EXPECT_STREQ("a\xF0\x9F\x98\x80" "b\xF0\x90\x8D\x88", s.utf8());
+    }
+
+    TEST_F(TestString, testLoneSurrogate) {
+        Array<uchar> a = {0xD83D, 'x'};
+        EXPECT_STREQ("\xED\xA0\xBD" "x", String(a).utf8());
+        char c[] = { char(0xF0), char(0x9F), char(0x98), 'y', 0x00 };
+        String s = c;
+        ASSERT_EQ(2u, s.length());
+        EXPECT_EQ(0xFFFD, s.at(0));
+        EXPECT_EQ('y', s.at(1));
+    }
+
+    TEST_F(TestString, testCodePoints) {
+        String s = "a\xF0\x9F\x98\x80\xC3\xA9\xF0\x90\x8D\x88";
+        uint32_t expected[] = { 'a', 0x1F600, 0xE9, 0x10348 };
+        size_t i = 0;
+        for (uint32_t cp : s.codePoints()) {
+            ASSERT_LT(i, 4u);
+            EXPECT_EQ(expected[i], cp);
+            ++i;
+        }
+        EXPECT_EQ(4u, i);
+
+        CodePoints cps = s.codePoints();
+        CodePointIterator it = cps.end();
+        --it;
+        EXPECT_EQ(4u, it.currentIndex());
+        EXPECT_EQ(0x10348u, *it);
+        --it;
+        EXPECT_EQ(0xE9u, *it);
+        --it;
+        EXPECT_EQ(0x1F600u, *it);
+        EXPECT_EQ(1u, it.currentIndex());
+
+        String e;
+        EXPECT_TRUE(e.codePoints().begin() == e.codePoints().end());
+
+        // short Strings have no shared data to tell them apart
+        String abc = "abc", xyz = "xyz";
+        EXPECT_FALSE(abc.codePoints().begin() == xyz.codePoints().begin());
+        EXPECT_TRUE(abc.codePoints().begin() == abc.codePoints().begin());
+        String labc = u"abc"_s, lxyz = u"xyz"_s;
+        EXPECT_FALSE(labc.codePoints().begin() == lxyz.codePoints().begin());
+    }
+
     TEST_F(TestString, testToAscii) {
         String s = "foobar";
         const char * c = s.ascii();
@@ -201,6 +363,28 @@ namespace {
         EXPECT_STREQ("français", c2);
     }
 
+    TEST_F(TestString, testToUtf8Cached) {
+        String s = "français, español, català";
+        String t = s;
+        const char * c = s.utf8();
+        EXPECT_STREQ("français, español, català", c);
+        EXPECT_EQ(c, s.utf8());
+        EXPECT_EQ(c, t.utf8());
+        EXPECT_NE(c, s.copy().utf8());
+        t += "!";
+        EXPECT_STREQ("français, español, català!", t.utf8());
+        EXPECT_STREQ("français, español, català", s.utf8());
+    }
+
+    TEST_F(TestString, testToUtf8Boundaries) {
+        Array<uchar> a = {0x7F, 0x80, 0x7FF, 0x800, 0xFFFF};
+        const char * c = String(a).utf8();
+        const char expected[] = { 0x7F, char(0xC2), char(0x80), char(0xDF),
+                char(0xBF), char(0xE0), char(0xA0), char(0x80), char(0xEF),
+                char(0xBF), char(0xBF), 0x00 };
+        EXPECT_STREQ(expected, c);
+    }
+
     TEST_F(TestString, testLowerCase) {
         String s = "foo";
         EXPECT_EQ("foo", s.toLowerCase());
@@ -230,6 +414,384 @@ namespace {
         EXPECT_FALSE(t.equalsIgnoreCase("Fox"));
     }
 
+    TEST_F(TestString, testCaseLongAscii) {
+        // Long enough for the blockwise path, with the characters just
+        // outside both letter ranges in every position.
+        String mixed = String("@AZ[`az{ Content-Type: Text/HTML; ") * 9;
+        String lower = String("@az[`az{ content-type: text/html; ") * 9;
+        String upper = String("@AZ[`AZ{ CONTENT-TYPE: TEXT/HTML; ") * 9;
+        EXPECT_EQ(lower, mixed.toLowerCase());
+        EXPECT_EQ(upper, mixed.toUpperCase());
+        EXPECT_EQ(String("@[`{"), String("@[`{").toLowerCase());
+        EXPECT_EQ(String(""), String("").toUpperCase());
+    }
+
+    TEST_F(TestString, testCaseUnicode) {
+        EXPECT_EQ(String("\xC3\xA9" "cole"),
+                String("\xC3\x89" "COLE").toLowerCase());
+        EXPECT_EQ(String("STRASSE"), String("stra\xC3\x9F" "e").toUpperCase());
+        String longer = String("\xC3\x9F") * 300;
+        EXPECT_EQ(String("SS") * 300, longer.toUpperCase());
+    }
+
+    TEST_F(TestString, testEquality) {
+        String a = String("0123456789abcdef") * 20;
+        String b = String("0123456789abcdef") * 20;
+        EXPECT_TRUE(a == b);
+        EXPECT_TRUE(a == a);
+        EXPECT_FALSE(a == b + "x");
+        EXPECT_FALSE(a + "x" == a + "y");
+        EXPECT_FALSE(String("x") + a == String("y") + b);
+        EXPECT_TRUE(String("") == String(""));
+        EXPECT_TRUE(String("short") == "short");
+        EXPECT_FALSE(String("short") == "shorT");
+    }
+
+    TEST_F(TestString, testLessThan) {
+        EXPECT_TRUE(String("abc") < String("abd"));
+        EXPECT_FALSE(String("abd") < String("abc"));
+        EXPECT_FALSE(String("abc") < String("abc"));
+        EXPECT_TRUE(String("ab") < String("abc"));
+        EXPECT_FALSE(String("abc") < String("ab"));
+        EXPECT_TRUE(String("") < String("a"));
+        EXPECT_FALSE(String("") < String(""));
+        EXPECT_TRUE(String("b") < String("ba"));
+        EXPECT_FALSE(String("ba") < String("b"));
+        EXPECT_TRUE(String("B") < String("a"));
+        EXPECT_TRUE(String("abc") <= String("abc"));
+        EXPECT_TRUE(String("abd") > String("abc"));
+
+        String a = String("0123456789abcdef") * 20;
+        EXPECT_FALSE(a < a);
+        EXPECT_TRUE(a + "a" < a + "b");
+        EXPECT_FALSE(a + "b" < a + "a");
+        EXPECT_TRUE(a < a + "a");
+        EXPECT_TRUE(a + "\xC3\xA9" < a + "\xC3\xAA");
+    }
+
+    TEST_F(TestString, testSort) {
+        srand(42);
+        const size_t count = 2000;
+        Array<String> keys((uint32_t)count);
+        std::vector<std::string> expected;
+        for (size_t i = 0; i < count; ++i) {
+            std::string key = "key/";
+            size_t length = rand() % 24;
+            for (size_t j = 0; j < length; ++j) key += char('a' + rand() % 4);
+            keys[i] = key.c_str();
+            expected.push_back(key);
+        }
+        std::sort(keys.carray(), keys.carray() + count);
+        std::sort(expected.begin(), expected.end());
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(String(expected[i].c_str()), keys[i]);
+        }
+    }
+
+    TEST_F(TestString, testCompareIgnoreCase) {
+        EXPECT_EQ(0, String("Foo").compareIgnoreCase("fOO"));
+        EXPECT_GT(0, String("apple").compareIgnoreCase("BANANA"));
+        EXPECT_LT(0, String("Banana").compareIgnoreCase("apple"));
+        EXPECT_GT(0, String("foo").compareIgnoreCase("FOOBAR"));
+        EXPECT_LT(0, String("FOOBAR").compareIgnoreCase("foo"));
+        EXPECT_EQ(0, String("").compareIgnoreCase(""));
+        // '_' sorts after 'Z' but before 'a', so the folded order matters.
+        EXPECT_LT(0, String("a").compareIgnoreCase("_"));
+        EXPECT_LT(0, String("A").compareIgnoreCase("_"));
+
+        String a = String("Accept-Encoding: GZIP, Deflate; ") * 8;
+        String b = String("accept-encoding: gzip, deflate; ") * 8;
+        EXPECT_EQ(0, a.compareIgnoreCase(b));
+        EXPECT_GT(0, a.compareIgnoreCase(b + "x"));
+        EXPECT_LT(0, (a + "y").compareIgnoreCase(b + "X"));
+    }
+
+    TEST_F(TestString, testEqualsIgnoreCaseUnicode) {
+        EXPECT_TRUE(String("Stra\xC3\x9F" "e").equalsIgnoreCase("STRASSE"));
+        EXPECT_TRUE(String("\xE2\x84\xAA").equalsIgnoreCase("k"));
+        EXPECT_TRUE(String("\xC3\x89" "cole").equalsIgnoreCase(
+                "\xC3\xA9" "COLE"));
+        EXPECT_FALSE(String("\xC3\x89" "cole").equalsIgnoreCase("ecole"));
+        String prefix = String("x") * 20;
+        EXPECT_TRUE((prefix + "\xC3\x89").equalsIgnoreCase(
+                prefix.toUpperCase() + "\xC3\xA9"));
+        EXPECT_TRUE(String("Yes").boolValue());
+        EXPECT_FALSE(String("nope").boolValue());
+    }
+
+    TEST_F(TestString, testLiteral) {
+        constexpr StringLiteral lit = u"abc"_s;
+        static_assert(lit.length == 3, "literal length");
+
+        String s = u"a literal longer than the inline capacity"_s;
+        String t = "a literal longer than the inline capacity";
+        EXPECT_EQ(t, s);
+        EXPECT_EQ(t.length(), s.length());
+        EXPECT_EQ('a', s.at(0));
+        EXPECT_EQ('y', s.at(-1));
+#if SYLPH_CHECKED_ARRAYS
+        EXPECT_THROW(s.at(s.length()), ArrayException);
+#endif
+        EXPECT_STREQ(t.utf8(), s.utf8());
+        EXPECT_EQ(Hash<String>()(t), Hash<String>()(s));
+
+        String copy = s;
+        EXPECT_EQ(s, copy);
+        copy = u"short"_s;
+        EXPECT_EQ(String("short"), copy);
+        EXPECT_EQ(t, s);
+
+        EXPECT_EQ(String("abcdef"), String(u"abc"_s) + u"def"_s);
+        EXPECT_EQ(String("ABC"), String(u"abc"_s).toUpperCase());
+        EXPECT_TRUE(String("x") == u"x"_s);
+        EXPECT_TRUE(String(u"a"_s) < u"b"_s);
+        EXPECT_TRUE(String(u""_s).empty());
+        EXPECT_EQ(2u, String(u"\U0001F600"_s).length());
+        EXPECT_STREQ("\xF0\x9F\x98\x80\xC3\xA9",
+                String(u"\U0001F600\u00E9"_s).utf8());
+
+        // streamed without utf8(), with a surrogate pair across chunks
+        static char16_t units[600];
+        for (size_t i = 0; i < 600; ++i) units[i] = u'a' + i % 26;
+        units[255] = 0xD83D;
+        units[256] = 0xDE00;
+        String streamed = StringLiteral(units, 600);
+        std::ostringstream out;
+        out << streamed;
+        EXPECT_EQ(std::string(streamed.copy().utf8()), out.str());
+        EXPECT_EQ(StringView(t).slice(2, 9), StringView(s).slice(2, 9));
+        EXPECT_EQ(t, s.intern());
+    }
+
+    TEST_F(TestString, testMove) {
+        String s = String("a String too long to be inline") + "!";
+        String copy = s;
+        String moved(std::move(s));
+        EXPECT_EQ(copy, moved);
+        EXPECT_TRUE(s.empty());
+
+        String small = "small";
+        String movedSmall(std::move(small));
+        EXPECT_EQ(String("small"), movedSmall);
+        EXPECT_TRUE(small.empty());
+
+        String target = "to be replaced by something longer";
+        target = std::move(moved);
+        EXPECT_EQ(copy, target);
+        EXPECT_TRUE(moved.empty());
+        target = std::move(target);
+        EXPECT_EQ(copy, target);
+
+        // Strings that were moved from can be reused.
+        s = "reused";
+        EXPECT_EQ(String("reused"), s);
+    }
+
+    TEST_F(TestString, testStringBufferMoveAndCopy) {
+        StringBuffer buf;
+        buf << "hello, " << "world";
+        StringBuffer copy(buf);
+        copy << "!";
+        EXPECT_EQ(String("hello, world"), buf.toString());
+        EXPECT_EQ(String("hello, world!"), copy.toString());
+
+        StringBuffer moved(std::move(copy));
+        EXPECT_EQ(String("hello, world!"), moved.toString());
+        EXPECT_EQ(0u, copy.length());
+        copy << "again";
+        EXPECT_EQ(String("again"), copy.toString());
+
+        buf = std::move(moved);
+        EXPECT_EQ(String("hello, world!"), buf.toString());
+        moved = buf;
+        moved << "?";
+        EXPECT_EQ(String("hello, world!"), buf.toString());
+        EXPECT_EQ(String("hello, world!?"), moved.toString());
+    }
+
+    TEST_F(TestString, testStringBufferAppend) {
+        StringBuffer buf;
+        buf.reserve(100);
+        EXPECT_LE(100u, buf.capacity());
+        size_t capacity = buf.capacity();
+        String smiley = "\xF0\x9F\x98\x80";
+        buf << "abc" << smiley << 'x' << true << ' ' << int32_t(-12)
+                << uint64_t(18446744073709551615ull) << 1.5;
+        EXPECT_EQ(capacity, buf.capacity());
+        EXPECT_EQ(String("abc") + smiley + "xtrue -12184467440737095516151.5",
+                buf.toString());
+
+        const uchar units[] = { 'd', 'e', 'f' };
+        buf.clear();
+        buf.append(units, 3);
+        buf << Array<uchar>({ uchar('g') });
+        EXPECT_EQ(String("defg"), buf.toString());
+
+        // a char is U+0000 to U+00FF, never sign extended
+        buf.clear();
+        buf << char(0xE9) << Array<char>({ 'a', char(0xFF) });
+        EXPECT_EQ(String("\xC3\xA9" "a\xC3\xBF"), buf.toString());
+
+        // Growing keeps what was there.
+        StringBuffer big(4);
+        for (int32_t i = 0; i < 1000; ++i) big << i;
+        EXPECT_EQ(2890u, big.length());
+        EXPECT_EQ(String("999"), big.toString().substring(2887));
+    }
+
+    TEST_F(TestString, testStringBufferHandOver) {
+        StringBuffer buf;
+        String line = "a line long enough to be stored on the heap\n";
+        for (int i = 0; i < 10; ++i) buf << line;
+        String expected = line * 10;
+        String copy = buf.toString();
+        EXPECT_EQ(expected, copy);
+        EXPECT_EQ(expected.length(), buf.length());
+
+        String taken = std::move(buf).toString();
+        EXPECT_EQ(expected, taken);
+        EXPECT_EQ(expected.length(), taken.length());
+        EXPECT_EQ(0u, buf.length());
+        // it was handed over, not copied
+        EXPECT_EQ(0u, buf.capacity());
+
+        // The StringBuffer can be used again, and doesn't share anything
+        // with the String it handed its buffer to.
+        buf << "new";
+        EXPECT_EQ(String("new"), buf.toString());
+        EXPECT_EQ(expected, taken);
+
+        // Mostly unused buffers, and short Strings, are copied instead.
+        StringBuffer sparse(4096);
+        sparse << line;
+        EXPECT_EQ(line, std::move(sparse).toString());
+        StringBuffer shortBuf;
+        shortBuf << "short";
+        String small = std::move(shortBuf);
+        EXPECT_EQ(String("short"), small);
+    }
+
+    TEST_F(TestString, testStringBufferEdit) {
+        StringBuffer buf(String("Hello, world!"));
+        EXPECT_EQ(String("Hello, world!"), buf.toString());
+
+        buf.deleteSubstring(5, 12);
+        EXPECT_EQ(String("Hello!"), buf.toString());
+        buf.insert(5, String(", there"));
+        EXPECT_EQ(String("Hello, there!"), buf.toString());
+        buf.insert(0, String(">> "));
+        buf.insert(buf.length(), String(" <<"));
+        EXPECT_EQ(String(">> Hello, there! <<"), buf.toString());
+        buf.replace(10, 15, String("you"));
+        EXPECT_EQ(String(">> Hello, you! <<"), buf.toString());
+        buf.replace(0, 3, String(""));
+        EXPECT_EQ(String("Hello, you! <<"), buf.toString());
+        EXPECT_EQ(14u, buf.length());
+
+        // characters on both sides of the gap
+        buf.insert(5, String("!"));
+        EXPECT_EQ('H', buf.at(0));
+        EXPECT_EQ('!', buf.at(5));
+        EXPECT_EQ(',', buf.at(6));
+        buf.at(14) = '>';
+        EXPECT_EQ(String("Hello!, you! <>"), buf.toString());
+
+        // appending and copying after an edit in the middle
+        buf.insert(2, String("LL"));
+        StringBuffer copy(buf);
+        buf << " end";
+        EXPECT_EQ(String("HeLLllo!, you! <> end"), buf.toString());
+        EXPECT_EQ(String("HeLLllo!, you! <>"), copy.toString());
+        copy.deleteSubstring(2, 4);
+        EXPECT_EQ(String("Hello!, you! <>"), std::move(copy).toString());
+
+        // growing while the gap is in the middle
+        StringBuffer grown(4);
+        grown << "ad";
+        grown.insert(1, String("bc"));
+        grown.insert(1, String("0123456789"));
+        EXPECT_EQ(String("a0123456789bcd"), grown.toString());
+
+        // a series of edits at the cursor, as a text editor would do
+        StringBuffer text(String("[]"));
+        for (int i = 0; i < 100; ++i) text.insert(1 + i, String("x"));
+        for (int i = 0; i < 50; ++i) text.deleteSubstring(1, 2);
+        EXPECT_EQ(String("[") + String("x") * 50 + String("]"),
+                text.toString());
+
+        EXPECT_THROW(buf.insert(buf.length() + 1, String("x")),
+                ArrayException);
+        EXPECT_THROW(buf.deleteSubstring(3, 2), ArrayException);
+        EXPECT_THROW(buf.replace(0, buf.length() + 1, String("x")),
+                ArrayException);
+        EXPECT_THROW(buf.at(buf.length()), ArrayException);
+    }
+
+    TEST_F(TestString, testUtf8Buffer) {
+        Utf8Buffer buf(4);
+        buf << "caf\xC3\xA9 " << String("na\xC3\xAFve \xF0\x9F\x98\x80")
+                << ' ' << int32_t(-42) << ' ' << uint32_t(7) << ' ' << false
+                << ' ' << 0.25;
+        const char expected[] = "caf\xC3\xA9 na\xC3\xAFve \xF0\x9F\x98\x80 "
+                "-42 7 false 0.25";
+        ASSERT_EQ(sizeof(expected) - 1, buf.length());
+        EXPECT_EQ(0, std::memcmp(expected, buf.data(), buf.length()));
+        EXPECT_EQ(String(expected), buf.toString());
+
+        Array<byte> bytes = buf.toArray();
+        EXPECT_EQ(buf.length(), bytes.length);
+
+        ByteBuffer out;
+        out << buf;
+        buf.writeTo(out);
+        EXPECT_EQ(2 * buf.length(), out.size());
+
+        Utf8Buffer moved = std::move(buf);
+        EXPECT_EQ(0u, buf.length());
+        EXPECT_EQ(String(expected), moved.toString());
+        buf << "again";
+        EXPECT_EQ(String("again"), buf.toString());
+
+        Utf8Buffer chars;
+        chars << 'a' << char(0xE9);
+        EXPECT_EQ(String("a\xC3\xA9"), chars.toString());
+
+        moved.clear();
+        EXPECT_EQ(0u, moved.length());
+        moved.writeTo(out);
+        EXPECT_EQ(2 * sizeof(expected) - 2, out.size());
+    }
+
+    TEST_F(TestString, testNormalize) {
+        String composed = "caf\xC3\xA9";
+        String decomposed = "cafe\xCC\x81";
+        EXPECT_NE(composed, decomposed);
+        EXPECT_EQ(composed, decomposed.normalize());
+        EXPECT_EQ(composed, composed.normalize(String::NFC));
+        EXPECT_EQ(decomposed, composed.normalize(String::NFD));
+        EXPECT_EQ(decomposed, decomposed.normalize(String::NFD));
+        EXPECT_EQ(String("fi"), String("\xEF\xAC\x81").normalize(String::NFKC));
+        EXPECT_EQ(String("\xEF\xAC\x81"),
+                String("\xEF\xAC\x81").normalize(String::NFC));
+        EXPECT_EQ(String("x2"), String("x\xC2\xB2").normalize(String::NFKD));
+        EXPECT_EQ(String("plain"), String("plain").normalize(String::NFD));
+
+        // A long normalized prefix followed by text that is not.
+        String prefix = String("\xC3\xA9t\xC3\xA9 ") * 100;
+        EXPECT_EQ(prefix + composed, (prefix + decomposed).normalize());
+        EXPECT_EQ((String("e\xCC\x81t") * 100).normalize(),
+                String("\xC3\xA9t") * 100);
+    }
+
+    TEST_F(TestString, testIsNormalized) {
+        EXPECT_TRUE(String("ascii only").isNormalized());
+        EXPECT_TRUE(String("caf\xC3\xA9").isNormalized());
+        EXPECT_FALSE(String("cafe\xCC\x81").isNormalized());
+        EXPECT_TRUE(String("cafe\xCC\x81").isNormalized(String::NFD));
+        EXPECT_FALSE(String("caf\xC3\xA9").isNormalized(String::NFD));
+        EXPECT_FALSE(String("\xEF\xAC\x81").isNormalized(String::NFKC));
+    }
+
     TEST_F(TestString, testContainment) {
         String s = "foobar";
         EXPECT_TRUE(s.contains("oba"));
@@ -240,6 +802,14 @@ namespace {
         EXPECT_EQ("wtf",s.trim());
     }
 
+    TEST_F(TestString, testTrimAllSpace) {
+        EXPECT_EQ("", String(" \t\n ").trim());
+        EXPECT_EQ("", String().trim());
+        EXPECT_EQ("x", String(" x").trim());
+        String s = "no spaces at all";
+        EXPECT_EQ(s, s.trim());
+    }
+
     TEST_F(TestString, testSplit) {
         String s = " a   beta ccc\td ";
         Array<String> result = s.split();
@@ -250,6 +820,100 @@ namespace {
         EXPECT_EQ("d",result[3]);
     }
 
+    TEST_F(TestString, testSplitLastToken) {
+        Array<String> result = String("a,bb,,c").split(Array<uchar>{','});
+        ASSERT_EQ(3u, result.length);
+        EXPECT_EQ("a", result[0]);
+        EXPECT_EQ("bb", result[1]);
+        EXPECT_EQ("c", result[2]);
+        EXPECT_EQ(0u, String(",,").split(Array<uchar>{','}).length);
+    }
+
+    TEST_F(TestString, testStringTokenizer) {
+        StringTokenizer tok(String("  one two\tthree  "));
+        EXPECT_EQ(3u, tok.countTokens());
+        StringTokenizer::iterator it = tok.begin();
+        EXPECT_EQ("one", *it);
+        ++it;
+        EXPECT_EQ("two", *it);
+        ++it;
+        EXPECT_EQ("three", *it);
+        ++it;
+        EXPECT_TRUE(it == tok.end());
+
+        // U+2014 is a delimiter outside the bitset
+        size_t count = 0;
+        String words[] = { "a", "b\xC3\xA9", "c" };
+        StringTokenizer dashes(String("a\xE2\x80\x94" "b\xC3\xA9,c,"),
+                Array<uchar>{ ',', 0x2014 });
+        for (const StringView& w : dashes) {
+            ASSERT_LT(count, 3u);
+            EXPECT_EQ(words[count], w);
+            ++count;
+        }
+        EXPECT_EQ(3u, count);
+
+        StringTokenizer none(String(" \t "));
+        EXPECT_EQ(0u, none.countTokens());
+        EXPECT_TRUE(none.begin() == none.end());
+        StringTokenizer empty((String()));
+        EXPECT_TRUE(empty.begin() == empty.end());
+
+        StringTokenizer one(String("x"));
+        EXPECT_EQ("x", *one.begin());
+        EXPECT_TRUE(++one.begin() == one.end());
+    }
+
+    TEST_F(TestString, testSplitIntoVector) {
+        Vector<StringView> tokens((size_t)4);
+        String("the quick  brown fox jumps").split(tokens);
+        ASSERT_EQ(5u, tokens.size());
+        EXPECT_EQ("quick", tokens[1]);
+        EXPECT_EQ("jumps", tokens[4]);
+        size_t capacity = tokens.capacity();
+
+        String(" a b ").split(tokens);
+        ASSERT_EQ(2u, tokens.size());
+        EXPECT_EQ("a", tokens[0]);
+        EXPECT_EQ("b", tokens[1]);
+        EXPECT_EQ(capacity, tokens.capacity());
+    }
+
+    TEST_F(TestString, testStringView) {
+        String s = "  the quick brown fox jumps  ";
+        StringView v = s.slice(2, 26);
+        EXPECT_EQ(25u, v.length());
+        EXPECT_EQ('t', v[0]);
+        EXPECT_EQ('s', v.at(-1));
+#if SYLPH_CHECKED_ARRAYS
+        EXPECT_THROW(v.at(25), ArrayException);
+#endif
+        EXPECT_EQ("quick", v.slice(4, 8));
+        EXPECT_EQ("jumps", v.slice(20));
+        EXPECT_EQ("fox", v.slice(10).slice(6, -7));
+        EXPECT_THROW(v.slice(5, 4), ArrayException);
+        EXPECT_EQ(v, s.trim());
+        EXPECT_EQ(v, StringView(s).trim());
+        EXPECT_EQ("", StringView("   ").trim());
+
+        EXPECT_EQ(10, v.indexOf("brown"));
+        EXPECT_EQ(-1, v.indexOf("  "));
+        EXPECT_EQ(18, v.lastIndexOf("x"));
+        EXPECT_TRUE(v.startsWith("the"));
+        EXPECT_TRUE(v.endsWith("jumps"));
+        EXPECT_FALSE(v.endsWith("jumps  "));
+        EXPECT_TRUE(v.contains("fox"));
+        EXPECT_FALSE(v.contains("dog"));
+        EXPECT_NE(v, "the");
+
+        // A view keeps its characters when the original is reassigned.
+        String quick = v.slice(4, 8);
+        s = "something else entirely";
+        EXPECT_EQ("the quick brown fox jumps", v);
+        EXPECT_EQ("quick", quick);
+        EXPECT_EQ(s, StringView(s).toString());
+    }
+
     TEST_F(TestString, testSubstring) {
         String s = "foobar";
         EXPECT_EQ("oba",s.substring(2,4));
@@ -279,6 +943,156 @@ namespace {
         });
     }
 
+    TEST_F(TestString, testSearchBoundaries) {
+        String s = "foobar";
+        EXPECT_EQ(3, s.indexOf("bar"));
+        EXPECT_EQ(5, s.indexOf("r"));
+        EXPECT_EQ(0, s.indexOf("foobar"));
+        EXPECT_EQ(-1, s.indexOf("foobarx"));
+        EXPECT_EQ(-1, s.indexOf("o", 3));
+        EXPECT_EQ(2, s.indexOf("o", 2));
+        EXPECT_EQ(-1, s.indexOf("o", 7));
+        EXPECT_EQ(1, s.indexOf("", 1));
+        EXPECT_EQ(0, s.lastIndexOf("fo", 1));
+        EXPECT_EQ(-1, s.lastIndexOf("foo", 1));
+        EXPECT_EQ(2, s.lastIndexOf("o", 4));
+        EXPECT_EQ(-1, String().lastIndexOf("a"));
+        EXPECT_TRUE(s.contains("bar"));
+        EXPECT_TRUE(s.endsWith("bar"));
+        EXPECT_FALSE(s.endsWith("xfoobar"));
+        EXPECT_TRUE(s.startsWith(""));
+    }
+
+    // Deterministic pseudo-random text over a tiny alphabet, so that partial
+    // matches are frequent. U+0161 shares its low byte with 'a'.
+    String searchText(uint32_t seed, size_t len) {
+        const uchar alphabet[] = { 'a', 'b', 0x0161 };
+        Array<uchar> buf(len);
+        for (idx_t i = 0; i < len; ++i) {
+            seed = seed * 1103515245 + 12345;
+            buf[i] = alphabet[(seed >> 16) % 3];
+        }
+        return buf;
+    }
+
+    sidx_t naiveIndexOf(const String& hay, const String& ndl, idx_t start) {
+        for (idx_t i = start; i + ndl.length() <= hay.length(); ++i) {
+            idx_t j = 0;
+            while (j < ndl.length() && hay.at(i + j) == ndl.at(j)) ++j;
+            if (j == ndl.length()) return i;
+        }
+        return -1;
+    }
+
+    sidx_t naiveLastIndexOf(const String& hay, const String& ndl, idx_t end) {
+        for (sidx_t i = sidx_t(end) - ndl.length() + 1; i >= 0; --i) {
+            idx_t j = 0;
+            while (j < ndl.length() && hay.at(i + j) == ndl.at(j)) ++j;
+            if (j == ndl.length()) return i;
+        }
+        return -1;
+    }
+
+    TEST_F(TestString, testSearchMatchesNaive) {
+        String hay = searchText(42, 300);
+        for (uint32_t k = 0; k < 200; ++k) {
+            size_t len = 1 + k % 40;
+            String ndl = k % 2 ? hay.substring(k, k + len - 1) :
+                    searchText(k, len);
+            idx_t start = k % 7 ? 0 : k;
+            idx_t end = k % 5 ? hay.length() - 1 : 299 - k;
+            EXPECT_EQ(naiveIndexOf(hay, ndl, start), hay.indexOf(ndl, start));
+            EXPECT_EQ(naiveLastIndexOf(hay, ndl, end),
+                    hay.lastIndexOf(ndl, end));
+        }
+    }
+
+    TEST_F(TestString, testStringSearcher) {
+        StringSearcher needle("needle in a haystack");
+        EXPECT_EQ("needle in a haystack", needle.needle());
+        String hay = String("hay") * 20 + "needle in a haystack" +
+                String("hay") * 20 + "needle in a haystack";
+        EXPECT_EQ(60, needle.indexIn(hay));
+        EXPECT_EQ(140, needle.indexIn(hay, 61));
+        EXPECT_EQ(-1, needle.indexIn(hay, 141));
+        EXPECT_EQ(140, needle.lastIndexIn(hay));
+        EXPECT_EQ(60, needle.lastIndexIn(hay, 139));
+        EXPECT_TRUE(needle.foundIn(hay));
+        EXPECT_FALSE(needle.foundIn(String("hay") * 20));
+    }
+
+    TEST_F(TestString, testStringMatcher) {
+        Array<String> patterns = { "he", "she", "his", "hers", "", "he" };
+        StringMatcher matcher(patterns);
+        Array<StringMatcher::Match> m = matcher.matchesIn("ushers");
+        ASSERT_EQ(4u, m.length);
+        EXPECT_EQ(1u, m[0].pattern);
+        EXPECT_EQ(1u, m[0].offset);
+        EXPECT_EQ(0u, m[1].pattern);
+        EXPECT_EQ(2u, m[1].offset);
+        EXPECT_EQ(5u, m[2].pattern);
+        EXPECT_EQ(2u, m[2].offset);
+        EXPECT_EQ(3u, m[3].pattern);
+        EXPECT_EQ(2u, m[3].offset);
+        EXPECT_TRUE(matcher.foundIn("this"));
+        EXPECT_FALSE(matcher.foundIn(String("a quiet day, ") * 20));
+        EXPECT_EQ(0u, matcher.matchesIn(String()).length);
+        EXPECT_EQ(0u, StringMatcher(Array<String>((size_t)0))
+                .matchesIn("ushers").length);
+    }
+
+    TEST_F(TestString, testStringMatcherMatchesNaive) {
+        String text = searchText(7, 500);
+        Array<String> patterns((size_t)30);
+        for (idx_t p = 0; p < patterns.length; ++p) {
+            size_t len = 1 + p % 9;
+            patterns[p] = p % 3 ? text.substring(p * 13, p * 13 + len - 1) :
+                    searchText(p, len);
+        }
+        Array<StringMatcher::Match> found =
+                StringMatcher(patterns).matchesIn(text);
+
+        // Every occurrence, by end position, then longest first.
+        idx_t k = 0;
+        for (idx_t end = 0; end < text.length(); ++end) {
+            for (size_t len = 9; len > 0; --len) {
+                for (idx_t p = 0; p < patterns.length; ++p) {
+                    if (patterns[p].length() != len || len > end + 1 ||
+                            !text.substring(end + 1 - len, end)
+                            .startsWith(patterns[p])) continue;
+                    ASSERT_LT(k, found.length);
+                    EXPECT_EQ(p, found[k].pattern);
+                    EXPECT_EQ(end + 1 - len, found[k].offset);
+                    ++k;
+                }
+            }
+        }
+        EXPECT_EQ(k, found.length);
+    }
+
+    TEST_F(TestString, testStringMatcherStream) {
+        // Long enough to span several chunks, with multi-byte sequences
+        // straddling the chunk boundaries.
+        String text = String("caf\xC3\xA9 na\xC3\xAFve \xF0\x9F\x98\x80 ") * 400;
+        Array<String> patterns = { "na\xC3\xAFve", "\xF0\x9F\x98\x80",
+                "\xC3\xA9 n" };
+        StringMatcher matcher(patterns);
+        const char * utf8 = text.utf8();
+        size_t len = std::strlen(utf8);
+        Array<byte> bytes(len);
+        for (idx_t i = 0; i < len; ++i) bytes[i] = utf8[i];
+        ByteBuffer buf(bytes);
+
+        Array<StringMatcher::Match> expected = matcher.matchesIn(text);
+        Array<StringMatcher::Match> streamed = matcher.matchesIn(buf);
+        ASSERT_EQ(1200u, expected.length);
+        ASSERT_EQ(expected.length, streamed.length);
+        for (idx_t i = 0; i < expected.length; ++i) {
+            EXPECT_EQ(expected[i].pattern, streamed[i].pattern);
+            EXPECT_EQ(expected[i].offset, streamed[i].offset);
+        }
+    }
+
     TEST_F(TestString, testHashUniqueness) {
         String s = "foo";
         String t = "bar";
@@ -294,6 +1108,76 @@ namespace {
         EXPECT_EQ(hashf(s),hashf(t));
     }
 
+    TEST_F(TestString, testHashCached) {
+        String s = "a String too long to be stored inline";
+        String t = String("a String too long ") + "to be stored inline";
+        Hash<String> hashf;
+        int32_t h = hashf(s);
+        EXPECT_EQ(h, hashf(s));
+        EXPECT_EQ(h, hashf(String(s)));
+        EXPECT_EQ(h, hashf(t));
+        EXPECT_EQ(h, Hash<String>(Hash<String>::DefaultSeed)(t));
+    }
+
+    TEST_F(TestString, testHashSeed) {
+        String s = "a String too long to be stored inline";
+        Hash<String> seeded(42);
+        EXPECT_EQ(seeded(s), Hash<String>(42)(s));
+        EXPECT_NE(seeded(s), Hash<String>()(s));
+        EXPECT_NE(seeded(s), Hash<String>(43)(s));
+        EXPECT_NE(seeded("foo"), Hash<String>()("foo"));
+    }
+
+    TEST_F(TestString, testHashDistribution) {
+        // Similar keys, short and long, bucketed the way HashMap does it.
+        const int buckets = 1024;
+        const int keys = 64 * buckets;
+        Hash<String> hashf;
+        int shortCount[buckets] = { 0 };
+        int longCount[buckets] = { 0 };
+        for (int i = 0; i < keys; ++i) {
+            String k = i;
+            shortCount[std::abs(hashf(k) % buckets)]++;
+            longCount[std::abs(hashf(String("/usr/share/doc/") + k) %
+                    buckets)]++;
+        }
+        // Chi-squared with 1023 degrees of freedom has a mean of 1023 and a
+        // standard deviation of about 45.
+        double shortChi = 0, longChi = 0;
+        for (int i = 0; i < buckets; ++i) {
+            shortChi += (shortCount[i] - 64.0) * (shortCount[i] - 64.0) / 64;
+            longChi += (longCount[i] - 64.0) * (longCount[i] - 64.0) / 64;
+        }
+        EXPECT_LT(shortChi, 1023 + 6 * 45);
+        EXPECT_LT(longChi, 1023 + 6 * 45);
+    }
+
+    TEST_F(TestString, testHashAvalanche) {
+        // Flipping any one input bit should flip about half the hash bits.
+        Hash<String> hashf;
+        const char * inputs[] = { "a", "foobar", "a String too long to be "
+                "stored inline, and longer than 48 bytes in UTF-16" };
+        for (const char * input : inputs) {
+            String s = input;
+            int32_t h = hashf(s);
+            Array<uchar> units = s.utf16();
+            long flipped = 0;
+            int trials = 0;
+            for (size_t i = 0; i < units.length; ++i) {
+                for (int bit = 0; bit < 16; ++bit) {
+                    Array<uchar> changed = units.copy();
+                    changed[i] ^= uchar(1 << bit);
+                    uint32_t diff = uint32_t(h ^ hashf(String(changed)));
+                    for (; diff; diff &= diff - 1) ++flipped;
+                    ++trials;
+                }
+            }
+            double average = double(flipped) / trials;
+            EXPECT_GT(average, 14.0) << input;
+            EXPECT_LT(average, 18.0) << input;
+        }
+    }
+
     TEST_F(TestString, testToBool) {
         String s = "true";
         EXPECT_TRUE(s.boolValue());
@@ -317,7 +1201,22 @@ namespace {
         String c = " 333 ";
         EXPECT_EQ(333, c.intValue());
         String d = "foobar";
-        EXPECT_EQ(0, d.intValue());
+        EXPECT_THROW(d.intValue(), ParseException);
+    }
+
+    TEST_F(TestString, testToIntErrors) {
+        EXPECT_THROW(String("").intValue(), ParseException);
+        EXPECT_THROW(String("-").intValue(), ParseException);
+        EXPECT_THROW(String("12a").intValue(), ParseException);
+        EXPECT_THROW(String("1 2").intValue(), ParseException);
+        EXPECT_THROW(String("2147483648").intValue(), ParseException);
+        EXPECT_THROW(String("-1").uintValue(), ParseException);
+        EXPECT_THROW(String("18446744073709551616").ulongValue(),
+                ParseException);
+        EXPECT_EQ(INT32_MIN, String("-2147483648").intValue());
+        EXPECT_EQ(UINT32_MAX, String("+4294967295").uintValue());
+        EXPECT_EQ(INT64_MIN, String("-9223372036854775808").longValue());
+        EXPECT_EQ(UINT64_MAX, String("18446744073709551615").ulongValue());
     }
 
     TEST_F(TestString, testToFloatSimple) {
@@ -325,6 +1224,45 @@ namespace {
         EXPECT_FLOAT_EQ(3.14f,s.floatValue());
     }
 
+    TEST_F(TestString, testToDouble) {
+        EXPECT_EQ(0.1, String("0.1").doubleValue());
+        EXPECT_EQ(-1500.0, String(" -1.5e+3 ").doubleValue());
+        EXPECT_EQ(0.5, String(".5").doubleValue());
+        EXPECT_EQ(5.0, String("5.").doubleValue());
+        EXPECT_EQ(5e-324, String("4.9406564584124654e-324").doubleValue());
+        EXPECT_EQ(0.0, String("1e-400").doubleValue());
+        // 2^53 + 1 is halfway between two doubles; the digits past the 19th
+        // decide which way it rounds.
+        EXPECT_EQ(9007199254740992.0,
+                String("9007199254740993").doubleValue());
+        EXPECT_EQ(9007199254740994.0,
+                String("9007199254740993.00000000000000000001").doubleValue());
+        EXPECT_EQ(16777216.f, String("16777217").floatValue());
+        EXPECT_TRUE(std::isnan(String("NaN").doubleValue()));
+        EXPECT_EQ(-std::numeric_limits<double>::infinity(),
+                String("-Infinity").doubleValue());
+    }
+
+    TEST_F(TestString, testToDoubleRoundTrip) {
+        double d = 1.0;
+        for (int i = 0; i < 1000; ++i) {
+            d *= -1.0123456789;
+            EXPECT_EQ(d, String(d).doubleValue());
+            EXPECT_EQ(float(d), String(float(d)).floatValue());
+        }
+    }
+
+    TEST_F(TestString, testToDoubleErrors) {
+        EXPECT_THROW(String("").doubleValue(), ParseException);
+        EXPECT_THROW(String(".").doubleValue(), ParseException);
+        EXPECT_THROW(String("1e").doubleValue(), ParseException);
+        EXPECT_THROW(String("1.2.3").doubleValue(), ParseException);
+        EXPECT_THROW(String("1,5").doubleValue(), ParseException);
+        EXPECT_THROW(String("inf").doubleValue(), ParseException);
+        EXPECT_THROW(String("1e400").doubleValue(), ParseException);
+        EXPECT_THROW(String("1e39").floatValue(), ParseException);
+    }
+
     TEST_F(TestString, testAppend) {
         String a = "foo";
         String b = "bar";
@@ -344,6 +1282,124 @@ namespace {
         EXPECT_EQ("ééééééé",v);
     }
 
+    TEST_F(TestString, testSmallStringBoundary) {
+        String s = "abcdefghijk";
+        String t = "abcdefghijkl";
+        ASSERT_EQ(String::SmallCapacity, s.length());
+        ASSERT_EQ(String::SmallCapacity + 1, t.length());
+        EXPECT_EQ('k', s.at(-1));
+        EXPECT_EQ('l', t.at(-1));
+#if SYLPH_CHECKED_ARRAYS
+        EXPECT_THROW(s.at(11), ArrayException);
+        EXPECT_THROW(s.at(-12), ArrayException);
+#endif
+        EXPECT_TRUE(s != t);
+        EXPECT_EQ(s, t.substring(0, 10));
+        EXPECT_TRUE(t.startsWith(s));
+    }
+
+    TEST_F(TestString, testSmallStringAppend) {
+        String s = "abcdef";
+        String t = s;
+        s += "ghijkl";
+        EXPECT_EQ("abcdefghijkl", s);
+        EXPECT_EQ("abcdef", t);
+        s += s;
+        EXPECT_EQ("abcdefghijklabcdefghijkl", s);
+        t = s.substring(20);
+        EXPECT_EQ("ijkl", t);
+        EXPECT_EQ(4u, t.length());
+    }
+
+    TEST_F(TestString, testSmallStringHash) {
+        String s = "foo";
+        String t = String("foofoofoofoo").substring(9);
+        Hash<String> hashf;
+        EXPECT_EQ(s, t);
+        EXPECT_EQ(hashf(s), hashf(t));
+        EXPECT_EQ(hashf(String("foofoofoofoo")),
+                hashf(String("foofoo") + String("foofoo")));
+    }
+
+#ifdef SYLPH_ATOMIC_REFCOUNT
+    void copyStringLoop(const String* shared) {
+        for (int i = 0; i < 100000; ++i) {
+            String s = *shared;
+            String t = s;
+            t = s;
+        }
+    }
+
+    TEST_F(TestString, testThreadedRefcount) {
+        String shared = "a String too long to be stored inline";
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.push_back(std::thread(copyStringLoop, &shared));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        EXPECT_EQ("a String too long to be stored inline", shared);
+    }
+
+    void internLoop(StringPool* pool, int offset) {
+        for (int i = 0; i < 10000; ++i) {
+            pool->intern(String("a String too long to be stored inline ") +
+                    String((i + offset) % 1000));
+        }
+    }
+
+    TEST_F(TestString, testThreadedIntern) {
+        StringPool pool;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.push_back(std::thread(internLoop, &pool, i * 100));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        EXPECT_EQ(1000u, pool.size());
+    }
+#endif
+
+    TEST_F(TestString, testIntern) {
+        String a = "a String too long to be stored inline";
+        String b = String("a String too long ") + "to be stored inline";
+        // The UTF-8 encoding is cached in the shared data, so equal pointers
+        // mean the data is shared.
+        EXPECT_NE(a.utf8(), b.utf8());
+        String ai = a.intern();
+        String bi = b.intern();
+        EXPECT_EQ(a, ai);
+        EXPECT_EQ(ai, bi);
+        EXPECT_EQ(ai.utf8(), bi.utf8());
+        EXPECT_EQ("foo", String("foo").intern());
+    }
+
+    TEST_F(TestString, testStringPool) {
+        StringPool pool;
+        EXPECT_EQ(0u, pool.size());
+        pool.intern("short");
+        EXPECT_EQ(0u, pool.size());
+
+        const String prefix = "a String too long to be stored inline ";
+        for (int i = 0; i < 1000; ++i) {
+            pool.intern(prefix + String(i));
+        }
+        EXPECT_EQ(1000u, pool.size());
+        String first = pool.intern(prefix + String(500));
+        String second = pool.intern(prefix + String(500));
+        EXPECT_EQ(1000u, pool.size());
+        EXPECT_EQ(first.utf8(), second.utf8());
+        EXPECT_EQ(prefix + String(500), first);
+
+        pool.clear();
+        EXPECT_EQ(0u, pool.size());
+        String third = pool.intern(prefix + String(500));
+        EXPECT_EQ(first, third);
+        EXPECT_NE(first.utf8(), third.utf8());
+    }
+
     TEST_F(TestString, testInvoke) {
         String s = "fooBAR";
         EXPECT_EQ(s.toLowerCase(), s&lc);
@@ -31,6 +31,7 @@
 
 #include <iterator>
 #include <time.h>
+#include <utility>
 
 using namespace Sylph;
 
@@ -137,6 +138,17 @@ namespace {
        	ASSERT_TRUE(testObj1.empty());
     }
 
+    TEST_F(TestVector, testClearKeepsCapacity) {
+        Vector<int> testObj1((size_t) 2);
+        for (int i = 0; i < 10; ++i) testObj1.add(i);
+        size_t capacity = testObj1.capacity();
+        testObj1.clear();
+        EXPECT_EQ(0u, testObj1.size());
+        EXPECT_EQ(capacity, testObj1.capacity());
+        testObj1.add(42);
+        EXPECT_EQ(42, testObj1.get(0));
+    }
+
     TEST_F(TestVector, testContains) {
         Vector<int> testObj1((size_t) 5);
         testObj1.add(7);
@@ -303,6 +315,38 @@ namespace {
 
     }
 
+    TEST_F(TestVector, testCopy) {
+        Vector<int> testObj1((size_t) 5);
+        for (int x = 0; x < 100; x++) testObj1.add(x);
+        Vector<int> testObj2(testObj1);
+        EXPECT_TRUE(testObj1 == testObj2);
+        testObj2[0] = -1;
+        testObj2.add(100);
+        EXPECT_EQ(0, testObj1[0]);
+        EXPECT_EQ(100u, testObj1.size());
+        EXPECT_EQ(101u, testObj2.size());
+    }
+
+    TEST_F(TestVector, testMove) {
+        Vector<int> testObj1((size_t) 5);
+        for (int x = 0; x < 100; x++) testObj1.add(x);
+        Vector<int> testObj2(std::move(testObj1));
+        EXPECT_EQ(100u, testObj2.size());
+        EXPECT_EQ(99, testObj2[99]);
+        EXPECT_TRUE(testObj1.empty());
+
+        Vector<int> testObj3((size_t) 5);
+        testObj3 = std::move(testObj2);
+        EXPECT_EQ(100u, testObj3.size());
+        EXPECT_TRUE(testObj2.empty());
+
+        // Vectors that were moved from can be reused.
+        testObj1.add(7);
+        testObj1.add(8);
+        EXPECT_EQ(2u, testObj1.size());
+        EXPECT_EQ(8, testObj1[1]);
+    }
+
 } // namespace
 
 // vim: ts=4:sts=4:sw=4:sta:et:tw=80:nobk:path=../../../src